@@ -0,0 +1,715 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <libgen.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+//  Benchmark runner
+// Drives every simulator with seeded workloads: the inputs are generated here
+// from the seed and scale, each binary is run a few times as a child process,
+// and the timings go to a JSON file. "compare" diffs two such files.
+
+#define MAX_WORKLOADS 16
+#define MAX_ARGS 8
+#define MAX_RUNS 32
+#define PARAMS_LEN 256
+#define DEFAULT_THRESHOLD 10.0      // percent slower before a change is flagged
+#define NOISE_FLOOR_MS 2.0          // absolute change always ignored
+
+typedef struct {
+    char bin_dir[PATH_MAX / 2];
+    char work_dir[PATH_MAX / 2];
+    uint64_t seed;
+    double scale;                   // multiplies every workload size
+    int repeats;
+} BenchConfig;
+
+typedef struct {
+    char binary[64];
+    char args[MAX_ARGS][PATH_MAX];
+    int argc;
+    char params[PARAMS_LEN];        // JSON members describing the input
+} Invocation;
+
+typedef int (*PrepareFn)(const BenchConfig *cfg, Invocation *inv);
+
+typedef struct {
+    const char *name;
+    PrepareFn prepare;
+} Workload;
+
+typedef struct {
+    int status;                     // exit status of the last failing run, else 0
+    double wall_ms[MAX_RUNS];
+    double user_ms[MAX_RUNS];
+    double sys_ms[MAX_RUNS];
+    double minor_faults[MAX_RUNS];
+    long max_rss_kb;
+} RunResult;
+
+//  Seeded generators
+
+uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+//uniform in [0, n)
+uint64_t randomBelow(uint64_t *state, uint64_t n) {
+    return (uint64_t)(((unsigned __int128)splitmix64(state) * n) >> 64);
+}
+
+double randomUnit(uint64_t *state) {
+    return (splitmix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//each input gets its own stream so adding a workload never changes another
+uint64_t workloadSeed(const BenchConfig *cfg, const char *input) {
+    uint64_t h = cfg->seed ^ 0xcbf29ce484222325ULL;
+    for (const char *p = input; *p; p++)
+        h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+    return h;
+}
+
+long scaled(const BenchConfig *cfg, long base, long minimum) {
+    long n = (long)(base * cfg->scale);
+    return n < minimum ? minimum : n;
+}
+
+void workPath(const BenchConfig *cfg, const char *name, char *out) {
+    snprintf(out, PATH_MAX, "%s/%s", cfg->work_dir, name);
+}
+
+void addArg(Invocation *inv, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void addArg(Invocation *inv, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(inv->args[inv->argc++], PATH_MAX, fmt, ap);
+    va_end(ap);
+}
+
+FILE *createInput(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        perror(path);
+    return fp;
+}
+
+//  ContiguousMemoryAllocation: allocation traces
+// Up to 512 live blocks, sizes log-uniform in 64 B .. 8 KiB, 55% allocations:
+// about 80% of a 1 MiB arena stays in use, so holes and compactions appear.
+#define ALLOC_MEMORY (1 << 20)
+#define ALLOC_MAX_LIVE 512
+#define ALLOC_REAL_MEMORY (16 << 20)
+
+int generateAllocTrace(const BenchConfig *cfg, const char *path, long ops) {
+    FILE *fp = createInput(path);
+    if (fp == NULL)
+        return -1;
+    uint64_t rng = workloadSeed(cfg, "alloc");
+    int live[ALLOC_MAX_LIVE], free_ids[ALLOC_MAX_LIVE];
+    int live_count = 0, free_count = ALLOC_MAX_LIVE;
+    for (int i = 0; i < ALLOC_MAX_LIVE; i++)
+        free_ids[i] = ALLOC_MAX_LIVE - 1 - i;
+    for (long i = 0; i < ops; i++) {
+        int allocate = live_count == 0 || (free_count > 0 && randomUnit(&rng) < 0.55);
+        if (allocate) {
+            int id = free_ids[--free_count];
+            int shift = (int)randomBelow(&rng, 7);
+            long size = (64L << shift) + (long)randomBelow(&rng, 64L << shift);
+            live[live_count++] = id;
+            fprintf(fp, "a %d %ld\n", id, size);
+        } else {
+            int k = (int)randomBelow(&rng, live_count);
+            int id = live[k];
+            live[k] = live[--live_count];
+            free_ids[free_count++] = id;
+            fprintf(fp, "f %d\n", id);
+        }
+    }
+    return fclose(fp);
+}
+
+// real: replay on a mapped region much larger than the live set, so the
+// strategies differ in how much of it they touch and fault in
+int prepareAlloc(const BenchConfig *cfg, Invocation *inv, int strategy, int real) {
+    static int generated;
+    char path[PATH_MAX];
+    long ops = scaled(cfg, 200000, 1000);
+    int memory = real ? ALLOC_REAL_MEMORY : ALLOC_MEMORY;
+    workPath(cfg, "alloc.trace", path);
+    if (!generated && generateAllocTrace(cfg, path, ops) != 0)
+        return -1;
+    generated = 1;
+    strcpy(inv->binary, "contiguous_alloc");
+    addArg(inv, real ? "real" : "trace");
+    addArg(inv, "%s", path);
+    addArg(inv, "%d", memory);
+    addArg(inv, "%d", strategy);
+    snprintf(inv->params, PARAMS_LEN,
+             "\"operations\": %ld, \"memory\": %d, \"max_live\": %d, \"strategy\": %d",
+             ops, memory, ALLOC_MAX_LIVE, strategy);
+    return 0;
+}
+
+int prepareAllocFirst(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 1, 0); }
+int prepareAllocBest(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 2, 0); }
+int prepareAllocWorst(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 3, 0); }
+int prepareAllocRealFirst(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 1, 1); }
+int prepareAllocRealBest(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 2, 1); }
+int prepareAllocRealWorst(const BenchConfig *cfg, Invocation *inv) { return prepareAlloc(cfg, inv, 3, 1); }
+
+//  Ipc_ring: ring throughput
+// Prime p travels p hops, so the work grows roughly with primes^2.
+int prepareRing(const BenchConfig *cfg, Invocation *inv) {
+    long primes = scaled(cfg, 400, 10);
+    strcpy(inv->binary, "ipc_ring");
+    addArg(inv, "-q");
+    addArg(inv, "-n");
+    addArg(inv, "%ld", primes);
+    snprintf(inv->params, PARAMS_LEN, "\"primes\": %ld", primes);
+    return 0;
+}
+
+//  Log_Analyzer: log scanning
+// A chain of files, each depending on the previous one. 55% INFO, 20% ERROR,
+// 20% WARNING and 5% malformed lines, one to 30 seconds apart.
+#define LOG_FILES 4
+
+static const char *log_messages[] = {
+    "user logged in", "authentication failed", "payment timeout", "invalid card",
+    "disk almost full", "connection reset by peer", "cache miss storm", "request queued",
+    "retrying upstream call", "session expired", "config reloaded", "slow query",
+};
+
+int generateLogs(const BenchConfig *cfg, const char *dir, long lines) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror(dir);
+        return -1;
+    }
+    uint64_t rng = workloadSeed(cfg, "logs");
+    time_t t = 1714521600;          // 2024-05-01 00:00:00 UTC
+    int message_count = sizeof(log_messages) / sizeof(log_messages[0]);
+    for (int f = 0; f < LOG_FILES; f++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/svc%d.txt", dir, f);
+        FILE *fp = createInput(path);
+        if (fp == NULL)
+            return -1;
+        if (f > 0)
+            fprintf(fp, "...svc%d.txt\n", f - 1);
+        for (long i = 0; i < lines; i++) {
+            double kind = randomUnit(&rng);
+            t += 1 + (time_t)randomBelow(&rng, 30);
+            if (kind < 0.05) {
+                fprintf(fp, "corrupted record %lu\n", (unsigned long)randomBelow(&rng, 1000));
+                continue;
+            }
+            const char *severity = kind < 0.60 ? "INFO" : kind < 0.80 ? "ERROR" : "WARNING";
+            struct tm tm;
+            char stamp[32];
+            gmtime_r(&t, &tm);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+            fprintf(fp, "%s | %s | %s (code %lu)\n", severity, stamp,
+                    log_messages[randomBelow(&rng, message_count)],
+                    (unsigned long)randomBelow(&rng, 100));
+        }
+        if (fclose(fp) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int prepareLogs(const BenchConfig *cfg, Invocation *inv, int summary) {
+    static int generated;
+    char dir[PATH_MAX];
+    long lines = scaled(cfg, 100000, 100);
+    workPath(cfg, "logs", dir);
+    if (!generated && generateLogs(cfg, dir, lines) != 0)
+        return -1;
+    generated = 1;
+    strcpy(inv->binary, "log_analyzer");
+    addArg(inv, "-d");
+    addArg(inv, "%s", dir);
+    addArg(inv, "-o");
+    addArg(inv, "%s/%s", cfg->work_dir, summary ? "log_summary.txt" : "log_scan.txt");
+    if (summary)
+        addArg(inv, "-a");
+    snprintf(inv->params, PARAMS_LEN, "\"files\": %d, \"lines_per_file\": %ld, \"summary\": %s",
+             LOG_FILES, lines, summary ? "true" : "false");
+    return 0;
+}
+
+int prepareLogScan(const BenchConfig *cfg, Invocation *inv) { return prepareLogs(cfg, inv, 0); }
+int prepareLogSummary(const BenchConfig *cfg, Invocation *inv) { return prepareLogs(cfg, inv, 1); }
+
+//  Memory Hierarchy Simulation: cache traces
+// Binary records (bit 63 = write): 60% in a 16 KiB hot set, 30% from a
+// 64-byte stride walk over 16 MiB, 10% anywhere in 256 MiB; 30% writes.
+// The simulator's defaults are toy-sized, so a 32 KiB L1, 512 KiB L2 and
+// 4 KiB pages are configured explicitly.
+#define CACHE_GEOMETRY "line=64,l1=64x8,l2=1024x8,page=4096,mem=4096,vm=65536"
+int generateCacheTrace(const BenchConfig *cfg, const char *path, long count) {
+    FILE *fp = createInput(path);
+    if (fp == NULL)
+        return -1;
+    uint64_t rng = workloadSeed(cfg, "cache");
+    uint64_t stream = 0;
+    uint64_t buffer[4096];
+    int filled = 0;
+    for (long i = 0; i < count; i++) {
+        double kind = randomUnit(&rng);
+        uint64_t address;
+        if (kind < 0.6) {
+            address = randomBelow(&rng, 16384) & ~7ULL;
+        } else if (kind < 0.9) {
+            address = (1ULL << 28) + stream;
+            stream = (stream + 64) % (16ULL << 20);
+        } else {
+            address = randomBelow(&rng, 1ULL << 28) & ~7ULL;
+        }
+        if (randomUnit(&rng) < 0.3)
+            address |= 1ULL << 63;
+        buffer[filled++] = address;
+        if (filled == 4096 || i == count - 1) {
+            fwrite(buffer, sizeof(uint64_t), filled, fp);
+            filled = 0;
+        }
+    }
+    return fclose(fp);
+}
+
+int prepareCache(const BenchConfig *cfg, Invocation *inv, int reuse) {
+    static int generated;
+    char path[PATH_MAX];
+    long count = scaled(cfg, 2000000, 1000);
+    workPath(cfg, "cache.bin", path);
+    if (!generated && generateCacheTrace(cfg, path, count) != 0)
+        return -1;
+    generated = 1;
+    strcpy(inv->binary, "memory_hierarchy");
+    addArg(inv, "-g");
+    addArg(inv, CACHE_GEOMETRY);
+    addArg(inv, "-b");
+    addArg(inv, "%s", path);
+    if (reuse) {
+        addArg(inv, "-r");
+        addArg(inv, "1");
+    }
+    snprintf(inv->params, PARAMS_LEN, "\"accesses\": %ld, \"geometry\": \"%s\", \"reuse\": %s",
+             count, CACHE_GEOMETRY, reuse ? "true" : "false");
+    return 0;
+}
+
+int prepareCacheTrace(const BenchConfig *cfg, Invocation *inv) { return prepareCache(cfg, inv, 0); }
+int prepareCacheReuse(const BenchConfig *cfg, Invocation *inv) { return prepareCache(cfg, inv, 1); }
+
+// No input file: the simulator generates the accesses itself from the seed,
+// one stream per core
+int prepareCacheSynthetic(const BenchConfig *cfg, Invocation *inv) {
+    long count = scaled(cfg, 2000000, 1000);
+    uint64_t seed = workloadSeed(cfg, "cache_synthetic");
+    strcpy(inv->binary, "memory_hierarchy");
+    addArg(inv, "-g");
+    addArg(inv, "%s,cores=4", CACHE_GEOMETRY);
+    addArg(inv, "-s");
+    addArg(inv, "%llu", (unsigned long long)seed);
+    addArg(inv, "-a");
+    addArg(inv, "%ld", count);
+    snprintf(inv->params, PARAMS_LEN, "\"accesses\": %ld, \"geometry\": \"%s\", \"cores\": 4",
+             count, CACHE_GEOMETRY);
+    return 0;
+}
+
+//  PageReplacement: page-reference strings
+// 32-bit pages: 70% skewed over 5000 hot pages, 20% a 1500-page loop,
+// 10% a scan of pages never seen before.
+int generatePageTrace(const BenchConfig *cfg, const char *path, long count) {
+    FILE *fp = createInput(path);
+    if (fp == NULL)
+        return -1;
+    uint64_t rng = workloadSeed(cfg, "pages");
+    int32_t loop = 0, scan = 0;
+    int32_t buffer[4096];
+    int filled = 0;
+    for (long i = 0; i < count; i++) {
+        double kind = randomUnit(&rng);
+        int32_t page;
+        if (kind < 0.7) {
+            double u = randomUnit(&rng);
+            page = (int32_t)(5000 * u * u * u);
+        } else if (kind < 0.9) {
+            page = 10000 + loop;
+            loop = (loop + 1) % 1500;
+        } else {
+            page = 100000 + scan++;
+        }
+        buffer[filled++] = page;
+        if (filled == 4096 || i == count - 1) {
+            fwrite(buffer, sizeof(int32_t), filled, fp);
+            filled = 0;
+        }
+    }
+    return fclose(fp);
+}
+
+int preparePages(const BenchConfig *cfg, Invocation *inv) {
+    char path[PATH_MAX];
+    long count = scaled(cfg, 2000000, 1000);
+    workPath(cfg, "pages.bin", path);
+    if (generatePageTrace(cfg, path, count) != 0)
+        return -1;
+    strcpy(inv->binary, "page_replacement");
+    addArg(inv, "-i");
+    addArg(inv, "%s", path);
+    addArg(inv, "-f");
+    addArg(inv, "1000");
+    snprintf(inv->params, PARAMS_LEN, "\"references\": %ld, \"frames\": 1000", count);
+    return 0;
+}
+
+static const Workload workloads[] = {
+    {"alloc_first", prepareAllocFirst},
+    {"alloc_best", prepareAllocBest},
+    {"alloc_worst", prepareAllocWorst},
+    {"alloc_real_first", prepareAllocRealFirst},
+    {"alloc_real_best", prepareAllocRealBest},
+    {"alloc_real_worst", prepareAllocRealWorst},
+    {"ring_throughput", prepareRing},
+    {"log_scan", prepareLogScan},
+    {"log_summary", prepareLogSummary},
+    {"cache_trace", prepareCacheTrace},
+    {"cache_reuse", prepareCacheReuse},
+    {"cache_synthetic", prepareCacheSynthetic},
+    {"page_stream", preparePages},
+};
+static const int workloadCount = sizeof(workloads) / sizeof(workloads[0]);
+
+//  Running
+
+double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+//one run with stdout and stderr going to the workload's log file
+int runOnce(const char *path, const Invocation *inv, const char *log_path, RunResult *r, int run) {
+    char *argv[MAX_ARGS + 2];
+    argv[0] = (char *)path;
+    for (int i = 0; i < inv->argc; i++)
+        argv[i + 1] = (char *)inv->args[i];
+    argv[inv->argc + 1] = NULL;
+
+    double start = nowMs();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv(path, argv);
+        perror(path);
+        _exit(127);
+    }
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) {
+        perror("wait4");
+        return -1;
+    }
+    r->wall_ms[run] = nowMs() - start;
+    r->user_ms[run] = ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3;
+    r->sys_ms[run] = ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3;
+    r->minor_faults[run] = ru.ru_minflt;
+    if (ru.ru_maxrss > r->max_rss_kb)
+        r->max_rss_kb = ru.ru_maxrss;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        r->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return 0;
+}
+
+int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double median(double *values, int n) {
+    qsort(values, n, sizeof(double), compareDouble);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+void jsonString(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', out);
+        if ((unsigned char)*s < 0x20)
+            fprintf(out, "\\u%04x", *s);
+        else
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+//true if name is on the comma-separated list (entries may be prefixes)
+int selected(const char *list, const char *name) {
+    if (list == NULL)
+        return 1;
+    const char *p = list;
+    while (*p) {
+        size_t n = strcspn(p, ",");
+        if (n > 0 && strncmp(p, name, n) == 0)
+            return 1;
+        p += n + (p[n] == ',');
+    }
+    return 0;
+}
+
+//each result is written on one line so "compare" can read it back line by line
+int runBenchmarks(const BenchConfig *cfg, const char *only, const char *out_path) {
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (out == NULL) {
+        perror(out_path);
+        return 1;
+    }
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host));
+    char stamp[32];
+    time_t t = time(NULL);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    fprintf(out, "{\n  \"timestamp\": \"%s\",\n  \"host\": ", stamp);
+    jsonString(out, host);
+    fprintf(out, ",\n  \"seed\": %llu,\n  \"scale\": %g,\n  \"repeats\": %d,\n  \"results\": [\n",
+            (unsigned long long)cfg->seed, cfg->scale, cfg->repeats);
+
+    int failures = 0, written = 0;
+    for (int w = 0; w < workloadCount; w++) {
+        const Workload *wl = &workloads[w];
+        if (!selected(only, wl->name))
+            continue;
+        Invocation inv;
+        memset(&inv, 0, sizeof(inv));
+        if (wl->prepare(cfg, &inv) != 0) {
+            fprintf(stderr, "%s: could not generate the input\n", wl->name);
+            failures++;
+            continue;
+        }
+        char path[PATH_MAX], log_path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", cfg->bin_dir, inv.binary);
+        snprintf(log_path, sizeof(log_path), "%s/%s.out", cfg->work_dir, wl->name);
+
+        RunResult r;
+        memset(&r, 0, sizeof(r));
+        int runs = 0;
+        while (runs < cfg->repeats && runOnce(path, &inv, log_path, &r, runs) == 0) {
+            runs++;
+            if (r.status != 0)
+                break;
+        }
+        if (runs == 0) {
+            failures++;
+            continue;
+        }
+        if (r.status != 0) {
+            fprintf(stderr, "%s: exited with status %d, see %s\n", wl->name, r.status, log_path);
+            failures++;
+        }
+        double lo = r.wall_ms[0], hi = r.wall_ms[0];
+        for (int i = 1; i < runs; i++) {
+            if (r.wall_ms[i] < lo) lo = r.wall_ms[i];
+            if (r.wall_ms[i] > hi) hi = r.wall_ms[i];
+        }
+        double wall = median(r.wall_ms, runs);
+        fprintf(stderr, "%-16s %10.1f ms  (min %.1f, max %.1f, %d runs)\n", wl->name, wall, lo, hi, runs);
+
+        char args[MAX_ARGS * PATH_MAX] = "";
+        for (int i = 0; i < inv.argc; i++) {
+            if (i > 0)
+                strcat(args, " ");
+            strcat(args, inv.args[i]);
+        }
+        fprintf(out, "%s    {\"name\": \"%s\", \"binary\": \"%s\", \"args\": ",
+                written++ ? ",\n" : "", wl->name, inv.binary);
+        jsonString(out, args);
+        fprintf(out, ", \"params\": {%s}, \"status\": %d, \"runs\": %d, \"wall_ms\": %.3f, "
+                "\"min_ms\": %.3f, \"max_ms\": %.3f, \"user_ms\": %.3f, \"sys_ms\": %.3f, "
+                "\"minor_faults\": %.0f, \"max_rss_kb\": %ld}",
+                inv.params, r.status, runs, wall, lo, hi, median(r.user_ms, runs),
+                median(r.sys_ms, runs), median(r.minor_faults, runs), r.max_rss_kb);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+    return failures ? 1 : 0;
+}
+
+//  Comparing two result files
+
+typedef struct {
+    char name[64];
+    int status;
+    double wall_ms;
+    long max_rss_kb;
+} SavedResult;
+
+//numeric member of a one-line result, or -1 if absent
+double member(const char *line, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    return p ? atof(p + strlen(pattern)) : -1;
+}
+
+int loadResults(const char *path, SavedResult *results, int max) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[4 * PATH_MAX];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), fp)) {
+        const char *p = strstr(line, "{\"name\": \"");
+        if (p == NULL)
+            continue;
+        SavedResult *r = &results[n++];
+        sscanf(p + 10, "%63[^\"]", r->name);
+        r->status = (int)member(line, "status");
+        r->wall_ms = member(line, "wall_ms");
+        r->max_rss_kb = (long)member(line, "max_rss_kb");
+    }
+    fclose(fp);
+    return n;
+}
+
+//exit status 1 if any workload got slower than the threshold, failed or vanished
+int compareResults(const char *base_path, const char *new_path, double threshold) {
+    SavedResult base[MAX_WORKLOADS * 4], cur[MAX_WORKLOADS * 4];
+    int nb = loadResults(base_path, base, MAX_WORKLOADS * 4);
+    int nc = loadResults(new_path, cur, MAX_WORKLOADS * 4);
+    if (nb < 0 || nc < 0)
+        return 2;
+
+    int regressions = 0;
+    printf("%-16s %12s %12s %9s %10s  %s\n", "workload", "base ms", "new ms", "change", "rss", "verdict");
+    for (int i = 0; i < nb; i++) {
+        const SavedResult *b = &base[i], *c = NULL;
+        for (int j = 0; j < nc; j++)
+            if (strcmp(cur[j].name, b->name) == 0)
+                c = &cur[j];
+        if (c == NULL) {
+            printf("%-16s %12.1f %12s %9s %10s  MISSING\n", b->name, b->wall_ms, "-", "-", "-");
+            regressions++;
+            continue;
+        }
+        double change = b->wall_ms > 0 ? 100.0 * (c->wall_ms - b->wall_ms) / b->wall_ms : 0;
+        double rss = b->max_rss_kb > 0 ? 100.0 * (c->max_rss_kb - b->max_rss_kb) / b->max_rss_kb : 0;
+        const char *verdict = "ok";
+        if (c->status != 0) {
+            verdict = "FAILED";
+            regressions++;
+        } else if (fabs(c->wall_ms - b->wall_ms) >= NOISE_FLOOR_MS && change > threshold) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (fabs(c->wall_ms - b->wall_ms) >= NOISE_FLOOR_MS && change < -threshold) {
+            verdict = "faster";
+        }
+        printf("%-16s %12.1f %12.1f %+8.1f%% %+9.1f%%  %s\n", b->name, b->wall_ms, c->wall_ms,
+               change, rss, verdict);
+    }
+    for (int j = 0; j < nc; j++) {
+        int known = 0;
+        for (int i = 0; i < nb; i++)
+            known |= strcmp(cur[j].name, base[i].name) == 0;
+        if (!known)
+            printf("%-16s %12s %12.1f %9s %10s  new\n", cur[j].name, "-", cur[j].wall_ms, "-", "-");
+    }
+    printf("%d regression%s (threshold %.1f%%)\n", regressions, regressions == 1 ? "" : "s", threshold);
+    return regressions ? 1 : 0;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-o results.json|-] [-s seed] [-x scale] [-r repeats] [-l workloads]\n"
+            "          [-B binary_dir] [-w work_dir]\n"
+            "       %s compare base.json new.json [threshold_percent]\n"
+            "       %s list\n", prog, prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "compare") == 0) {
+        if (argc < 4) {
+            usage(argv[0]);
+            return 2;
+        }
+        double threshold = argc > 4 ? atof(argv[4]) : DEFAULT_THRESHOLD;
+        return compareResults(argv[2], argv[3], threshold);
+    }
+    if (argc > 1 && strcmp(argv[1], "list") == 0) {
+        for (int i = 0; i < workloadCount; i++)
+            printf("%s\n", workloads[i].name);
+        return 0;
+    }
+
+    BenchConfig cfg;
+    cfg.seed = 1;
+    cfg.scale = 1;
+    cfg.repeats = 3;
+    strcpy(cfg.work_dir, "bench_work");
+    //binaries default to the directory this runner lives in (the build tree)
+    char self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len > 0) {
+        self[len] = 0;
+        snprintf(cfg.bin_dir, sizeof(cfg.bin_dir), "%s", dirname(self));
+    } else {
+        strcpy(cfg.bin_dir, ".");
+    }
+    const char *out_path = "results.json";
+    const char *only = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:s:x:r:l:B:w:")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            case 's': cfg.seed = strtoull(optarg, NULL, 0); break;
+            case 'x': cfg.scale = atof(optarg); break;
+            case 'r': cfg.repeats = atoi(optarg); break;
+            case 'l': only = optarg; break;
+            case 'B': snprintf(cfg.bin_dir, sizeof(cfg.bin_dir), "%s", optarg); break;
+            case 'w': snprintf(cfg.work_dir, sizeof(cfg.work_dir), "%s", optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (cfg.scale <= 0 || cfg.repeats < 1 || cfg.repeats > MAX_RUNS) {
+        fprintf(stderr, "scale must be positive and repeats in 1 .. %d\n", MAX_RUNS);
+        return 2;
+    }
+    if (mkdir(cfg.work_dir, 0755) != 0 && errno != EEXIST) {
+        perror(cfg.work_dir);
+        return 2;
+    }
+    return runBenchmarks(&cfg, only, out_path);
+}
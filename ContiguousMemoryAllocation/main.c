@@ -1,193 +1,280 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
 
-#define MAX_MEMORY_SIZE 1024
-#define MIN_PARTITION_SIZE 64
+#include "memory_manager.h"
 
-typedef struct MemoryBlock {
-    size_t size;
-    size_t start_address;
-    bool is_allocated;
-    struct MemoryBlock* next;
-} MemoryBlock;
+#define MAX_MEMORY_SIZE 1024
+#define TRACE_MAX_IDS 65536
+#define SCAN_INTERVAL 1000      // requests between two passes over the live blocks
+#define CACHE_LINE 64
 
+// Allocation traces
+// One operation per line: "a <id> <size>" allocates, "f <id>" frees the
+// block allocated under that id. Ids are small integers chosen by the trace.
 typedef struct {
-    MemoryBlock* head;
-    size_t total_size;
-    size_t free_size;
-    int allocation_strategy;
-} MemoryManager;
-
-// Initialize manager 
-MemoryManager* initMemoryManager(size_t size, int strategy) {
-    MemoryManager* manager = (MemoryManager*)malloc(sizeof(MemoryManager));
-    if (!manager) return NULL;
-    manager->total_size = size;
-    manager->free_size = size;
-    manager->allocation_strategy = strategy;
-    MemoryBlock* b = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-    if (!b) { free(manager); return NULL; }
-    b->size = size;
-    b->start_address = 0;
-    b->is_allocated = false;
-    b->next = NULL;
-    manager->head = b;
-    return manager;
-}
+    char op;
+    int id;
+    size_t size;
+} TraceOp;
 
-// Selection functions 
-MemoryBlock* firstFit(MemoryManager* manager, size_t size) {
-    MemoryBlock* cur = manager->head;
-    while (cur)
-    {
-        if (!cur->is_allocated && cur->size >= size)
-            return cur; cur = cur->next;
-    }
-    return NULL;
-}
-MemoryBlock* bestFit(MemoryManager* manager, size_t size)
+TraceOp* loadTrace(const char* path, long* count)
 {
-    MemoryBlock* cur = manager->head; MemoryBlock* best = NULL;
-    while (cur)
-    {
-        if(!cur->is_allocated && cur->size >= size)
-        {
-            if (!best || cur->size < best->size)
-                best = cur;
+    FILE* fp = fopen(path, "r");
+    if (!fp) { perror(path); return NULL; }
+    long cap = 1024, n = 0;
+    TraceOp* ops = (TraceOp*)malloc(sizeof(TraceOp) * cap);
+    char line[128];
+    while (ops && fgets(line, sizeof(line), fp)) {
+        TraceOp op = {0, 0, 0};
+        if (sscanf(line, " a %d %zu", &op.id, &op.size) == 2) op.op = 'a';
+        else if (sscanf(line, " f %d", &op.id) == 1) op.op = 'f';
+        else continue;
+        if (op.id < 0 || op.id >= TRACE_MAX_IDS) {
+            fprintf(stderr, "%s: id %d out of range (0 .. %d)\n", path, op.id, TRACE_MAX_IDS - 1);
+            free(ops);
+            fclose(fp);
+            return NULL;
+        }
+        if (n == cap) {
+            cap *= 2;
+            TraceOp* grown = (TraceOp*)realloc(ops, sizeof(TraceOp) * cap);
+            if (!grown) { free(ops); ops = NULL; break; }
+            ops = grown;
         }
-        cur = cur->next;
+        ops[n++] = op;
     }
-    return best;
+    fclose(fp);
+    *count = n;
+    return ops;
 }
-MemoryBlock* worstFit(MemoryManager* manager, size_t size)
+
+// Replay a trace with one strategy. A failed allocation compacts memory and
+// is retried once, as an OS would before refusing the request.
+void replayTrace(const TraceOp* ops, long count, size_t memory_size, int strategy)
 {
-    MemoryBlock* cur = manager->head; MemoryBlock* worst = NULL;
-    while (cur)
-    { 
-        if (!cur->is_allocated && cur->size >= size)
-        {
-            if (!worst || cur->size > worst->size)
-            worst = cur;
+    const char* names[] = {"First Fit", "Best Fit", "Worst Fit"};
+    MemoryManager* mm = initMemoryManager(memory_size, strategy);
+    MemoryStats stats;
+    MemoryBlock** live = (MemoryBlock**)calloc(TRACE_MAX_IDS, sizeof(MemoryBlock*));
+    long requests = 0, failures = 0, compactions = 0;
+    size_t peak_blocks = 1;
+    double used = 0;                    // sum of allocated bytes after each request
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < count; i++) {
+        const TraceOp* op = &ops[i];
+        if (op->op == 'f') {
+            if (!live[op->id]) continue;    // its allocation failed
+            deallocate(mm, (void*)(uintptr_t)blockAddress(live[op->id]));
+            live[op->id] = NULL;
+            continue;
+        }
+        if (live[op->id]) continue;         // id still in use
+        requests++;
+        MemoryBlock* b = allocateBlock(mm, op->size);
+        if (!b) {
+            getMemoryStats(mm, &stats);
+            if (op->size >= DEFAULT_MIN_PARTITION && op->size <= stats.free_size) {
+                compactMemory(mm);
+                compactions++;
+                b = allocateBlock(mm, op->size);
+            }
         }
-        cur = cur->next;
+        if (!b) failures++;
+        live[op->id] = b;
+        getMemoryStats(mm, &stats);
+        used += stats.total_size - stats.free_size;
+        if (stats.blocks > peak_blocks) peak_blocks = stats.blocks;
     }
-    return worst;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // External fragmentation: share of free memory outside the largest hole
+    getMemoryStats(mm, &stats);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%-9s | requests %ld | failed %ld (%.2f%%) | compactions %ld | "
+           "peak blocks %zu | avg utilisation %.1f%% | fragmentation %.1f%% | %.3f s\n",
+           names[strategy - 1], requests, failures,
+           requests ? 100.0 * failures / requests : 0.0, compactions, peak_blocks,
+           requests ? 100.0 * used / requests / stats.total_size : 0.0,
+           stats.free_size ? 100.0 * (stats.free_size - stats.largest_free) / stats.free_size : 0.0,
+           elapsed);
+
+    free(live);
+    destroyMemoryManager(mm);
 }
 
-// Allocate with splitting 
-void* allocateMemory(MemoryManager* manager, size_t size) 
+static double secondsSince(const struct timespec* t0)
 {
-    if (!manager) return NULL;
-    if (size < MIN_PARTITION_SIZE) return NULL;
-    if (size > manager->free_size) return NULL;
-
-    MemoryBlock* target = NULL;
-    switch (manager->allocation_strategy) {
-        case 1: target = firstFit(manager, size); break;
-        case 2: target = bestFit(manager, size); break;
-        case 3: target = worstFit(manager, size); break;
-        default: return NULL;
-    }
-    if (!target) return NULL;
-
-    if (target->size > size + MIN_PARTITION_SIZE) {
-        MemoryBlock* leftover = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-        leftover->size = target->size - size;
-        leftover->start_address = target->start_address + size;
-        leftover->is_allocated = false;
-        leftover->next = target->next;
-        target->size = size;
-        target->next = leftover;
-    }
-
-    target->is_allocated = true;
-    manager->free_size -= target->size;
-    return (void*)(uintptr_t)target->start_address;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
 }
 
-/* Deallocate */
-void deallocate(MemoryManager* manager, void* address) 
+// The scans' sums end up here, so the reads cannot be optimised away
+static volatile uint64_t scanSink;
+
+// Read one word per cache line of every live block, in id order rather than
+// address order, the way a program walks its objects
+static uint64_t scanLive(const MemoryManager* mm, MemoryBlock** live, int* ids, int live_count)
 {
-    if (!manager) return;
-    size_t addr = (size_t)(uintptr_t)address;
-    MemoryBlock* cur = manager->head;
-    while (cur) {
-        if (cur->is_allocated && cur->start_address == addr) {
-            cur->is_allocated = false;
-            manager->free_size += cur->size;
-            return;
-        }
-        cur = cur->next;
+    uint64_t sum = 0;
+    for (int k = 0; k < live_count; k++) {
+        MemoryBlock* b = live[ids[k]];
+        const unsigned char* p = (const unsigned char*)blockData(mm, b);
+        size_t size = blockSize(b);
+        for (size_t off = 0; off < size; off += CACHE_LINE) sum += p[off];
     }
-    printf("Error: invalid address %zu\n", addr);
+    return sum;
 }
 
-
-void compactMemory(MemoryManager* manager) 
+// Replay a trace on real memory. Every allocation is filled with a byte
+// derived from its id and checked when it is freed, so a compaction that
+// lost data shows up as a corrupt block. Reports the page faults the
+// strategy caused, how far into the mapping it reached, the cost of
+// periodic passes over the live blocks and the bytes compaction moved.
+void replayReal(const TraceOp* ops, long count, size_t memory_size, int strategy, int backing)
 {
-    if (!manager) return;
-    size_t next_addr = 0;
-    MemoryBlock* cur = manager->head;
-    MemoryBlock* new_head = NULL;
-    MemoryBlock* tail = NULL;
-
-    // Collect allocated blocks and relocate them to front
-    while (cur) {
-        if (cur->is_allocated) {
-            MemoryBlock* nb = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-            nb->size = cur->size;
-            nb->start_address = next_addr;
-            nb->is_allocated = true;
-            nb->next = NULL;
-            next_addr += nb->size;
-            if (!new_head) new_head = nb; else tail->next = nb;
-            tail = nb;
-        }
-        cur = cur->next;
+    const char* names[] = {"First Fit", "Best Fit", "Worst Fit"};
+    const char* backings[] = {"simulated", "4K pages", "hugetlb", "THP"};
+    MemoryConfig cfg;
+    defaultMemoryConfig(&cfg);
+    cfg.size = memory_size;
+    cfg.strategy = strategy;
+    cfg.backing = backing;
+    MemoryManager* mm = createMemoryManager(&cfg);
+    if (!mm) {
+        perror("mmap");
+        return;
     }
+    MemoryStats stats;
+    MemoryBlock** live = (MemoryBlock**)calloc(TRACE_MAX_IDS, sizeof(MemoryBlock*));
+    int* ids = (int*)malloc(sizeof(int) * TRACE_MAX_IDS);      // live ids, unordered
+    int* slot = (int*)malloc(sizeof(int) * TRACE_MAX_IDS);     // id -> index in ids
+    int live_count = 0;
+    long requests = 0, failures = 0, compactions = 0, corrupt = 0, scans = 0;
+    size_t high_water = 0;
+    double scan_seconds = 0;
+    uint64_t checksum = 0;
 
-    // Append a single free block with remaining memory
-    if (next_addr < manager->total_size) {
-        MemoryBlock* freeb = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-        freeb->size = manager->total_size - next_addr;
-        freeb->start_address = next_addr;
-        freeb->is_allocated = false;
-        freeb->next = NULL;
-        if (!new_head) new_head = freeb; else tail->next = freeb;
+    struct rusage r0, r1;
+    struct timespec t0, ts;
+    getrusage(RUSAGE_SELF, &r0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < count; i++) {
+        const TraceOp* op = &ops[i];
+        unsigned char tag = (unsigned char)(op->id * 31 + 7);
+        if (op->op == 'f') {
+            MemoryBlock* b = live[op->id];
+            if (!b) continue;
+            const unsigned char* p = (const unsigned char*)blockData(mm, b);
+            size_t size = blockSize(b);
+            for (size_t k = 0; k < size; k++) {
+                if (p[k] != tag) { corrupt++; break; }
+            }
+            deallocate(mm, blockData(mm, b));
+            live[op->id] = NULL;
+            int moved = ids[--live_count];
+            ids[slot[op->id]] = moved;
+            slot[moved] = slot[op->id];
+            continue;
+        }
+        if (live[op->id]) continue;
+        requests++;
+        MemoryBlock* b = allocateBlock(mm, op->size);
+        if (!b) {
+            getMemoryStats(mm, &stats);
+            if (op->size >= DEFAULT_MIN_PARTITION && op->size <= stats.free_size) {
+                compactMemory(mm);
+                compactions++;
+                b = allocateBlock(mm, op->size);
+            }
+        }
+        if (!b) { failures++; continue; }
+        memset(blockData(mm, b), tag, blockSize(b));
+        if (blockAddress(b) + blockSize(b) > high_water) high_water = blockAddress(b) + blockSize(b);
+        live[op->id] = b;
+        slot[op->id] = live_count;
+        ids[live_count++] = op->id;
+        if (requests % SCAN_INTERVAL == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            checksum += scanLive(mm, live, ids, live_count);
+            scan_seconds += secondsSince(&ts);
+            scans++;
+        }
     }
+    double elapsed = secondsSince(&t0);
+    getrusage(RUSAGE_SELF, &r1);
 
-    // Replace old list with new compacted list
-    manager->head = new_head;
-}
+    getMemoryStats(mm, &stats);
+    printf("%-9s | %s | requests %ld | failed %ld | compactions %ld (%.1f MiB moved) | "
+           "minor faults %ld | reached %zu KiB | %ld scans %.3f s | corrupt %ld | %.3f s\n",
+           names[strategy - 1], backings[stats.backing], requests, failures, compactions,
+           stats.moved_bytes / 1048576.0, r1.ru_minflt - r0.ru_minflt, high_water / 1024, scans,
+           scan_seconds, corrupt, elapsed);
+    scanSink = checksum;
 
-// Print layout
-void printMemory(MemoryManager* manager) 
-{
-    MemoryBlock* cur = manager->head;
-    printf("[Memory Layout]: ");
-    while (cur) {
-        printf("[%s | Addr: %zu | Size: %zu] -> ",
-               cur->is_allocated ? "ALLOC" : "FREE ",
-               cur->start_address,
-               cur->size);
-        cur = cur->next;
-    }
-    printf("NULL\n");
+    free(slot);
+    free(ids);
+    free(live);
+    destroyMemoryManager(mm);
 }
 
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "trace") == 0) {
+        // ./main trace file [memory_size] [strategy (0 = all)]
+        size_t memory_size = argc > 3 ? strtoul(argv[3], NULL, 10) : 1 << 20;
+        int strategy = argc > 4 ? atoi(argv[4]) : 0;
+        if (argc < 3 || memory_size < DEFAULT_MIN_PARTITION || strategy < 0 || strategy > 3) {
+            fprintf(stderr, "usage: %s trace file [memory_size] [strategy (1 first, 2 best, "
+                    "3 worst, 0 all)]\n", argv[0]);
+            return 1;
+        }
+        long count;
+        TraceOp* ops = loadTrace(argv[2], &count);
+        if (!ops) return 1;
+        for (int s = 1; s <= 3; ++s)
+            if (strategy == 0 || strategy == s)
+                replayTrace(ops, count, memory_size, s);
+        free(ops);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "real") == 0) {
+        // ./main real file [memory_size] [strategy (0 = all)] [huge|thp]
+        size_t memory_size = argc > 3 ? strtoul(argv[3], NULL, 10) : 1 << 20;
+        int strategy = argc > 4 ? atoi(argv[4]) : 0;
+        int backing = BACKING_MMAP;
+        if (argc > 5) backing = strcmp(argv[5], "huge") == 0 ? BACKING_HUGETLB
+                              : strcmp(argv[5], "thp") == 0 ? BACKING_THP : -1;
+        if (argc < 3 || memory_size < DEFAULT_MIN_PARTITION || strategy < 0 || strategy > 3 ||
+            backing < 0) {
+            fprintf(stderr, "usage: %s real file [memory_size (bytes)] [strategy (1 first, "
+                    "2 best, 3 worst, 0 all)] [huge|thp]\n", argv[0]);
+            return 1;
+        }
+        long count;
+        TraceOp* ops = loadTrace(argv[2], &count);
+        if (!ops) return 1;
+        for (int s = 1; s <= 3; ++s)
+            if (strategy == 0 || strategy == s)
+                replayReal(ops, count, memory_size, s, backing);
+        free(ops);
+        return 0;
+    }
 
-int main() {
     const char* names[] = {"First Fit", "Best Fit", "Worst Fit"};
     for (int s = 1; s <= 3; ++s) {
         printf("\n============== Strategy %d: %s ============== \n", s, names[s-1]);
         MemoryManager* mm = initMemoryManager(MAX_MEMORY_SIZE, s);
 
         printf("Allocating A:200, B:200, C:200\n");
-        void* A = allocateMemory(mm, 200);
+        allocateMemory(mm, 200);
         void* B = allocateMemory(mm, 200);
-        void* C = allocateMemory(mm, 200);
+        allocateMemory(mm, 200);
         printMemory(mm);
 
         printf("\nFreeing B\n");
@@ -202,7 +289,7 @@ int main() {
         compactMemory(mm);
         printMemory(mm);
 
-        free(mm);
+        destroyMemoryManager(mm);
     }
     return 0;
 }
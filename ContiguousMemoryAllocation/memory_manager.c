@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "memory_manager.h"
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+struct MemoryBlock {
+    size_t size;
+    size_t start_address;
+    bool is_allocated;
+    struct MemoryBlock* next;
+};
+
+struct MemoryManager {
+    MemoryBlock* head;
+    size_t total_size;
+    size_t free_size;
+    int allocation_strategy;
+    size_t min_partition;
+    int backing;
+    unsigned char* base;        // NULL when simulated
+    size_t mapped_size;
+    size_t moved_bytes;
+};
+
+void defaultMemoryConfig(MemoryConfig* cfg)
+{
+    cfg->size = DEFAULT_MEMORY_SIZE;
+    cfg->strategy = FIRST_FIT;
+    cfg->min_partition = DEFAULT_MIN_PARTITION;
+    cfg->backing = BACKING_SIMULATED;
+}
+
+// Map the managed range; huge pages need a reservation (vm.nr_hugepages),
+// without one the kernel is asked for transparent huge pages instead
+static int mapBacking(MemoryManager* manager, int backing)
+{
+    void* p = MAP_FAILED;
+    if (backing == BACKING_HUGETLB) {
+        manager->mapped_size = (manager->total_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        p = mmap(NULL, manager->mapped_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) manager->backing = BACKING_HUGETLB;
+    }
+    if (p == MAP_FAILED) {
+        manager->mapped_size = manager->total_size;
+        p = mmap(NULL, manager->mapped_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return -1;
+        manager->backing = BACKING_MMAP;
+#ifdef MADV_HUGEPAGE
+        if (backing != BACKING_MMAP && madvise(p, manager->mapped_size, MADV_HUGEPAGE) == 0)
+            manager->backing = BACKING_THP;
+#endif
+    }
+    manager->base = (unsigned char*)p;
+    return 0;
+}
+
+// Initialize manager 
+MemoryManager* createMemoryManager(const MemoryConfig* cfg)
+{
+    if (!cfg || cfg->strategy < FIRST_FIT || cfg->strategy > WORST_FIT) return NULL;
+    if (cfg->size == 0 || cfg->min_partition == 0) return NULL;
+    if (cfg->backing < BACKING_SIMULATED || cfg->backing > BACKING_THP) return NULL;
+    MemoryManager* manager = (MemoryManager*)malloc(sizeof(MemoryManager));
+    if (!manager) return NULL;
+    size_t size = cfg->size;
+    manager->total_size = size;
+    manager->free_size = size;
+    manager->allocation_strategy = cfg->strategy;
+    manager->min_partition = cfg->min_partition;
+    manager->head = NULL;
+    manager->backing = BACKING_SIMULATED;
+    manager->base = NULL;
+    manager->mapped_size = 0;
+    manager->moved_bytes = 0;
+    if (cfg->backing != BACKING_SIMULATED && mapBacking(manager, cfg->backing) != 0) {
+        free(manager);
+        return NULL;
+    }
+    MemoryBlock* b = (MemoryBlock*)malloc(sizeof(MemoryBlock));
+    if (!b) { destroyMemoryManager(manager); return NULL; }
+    b->size = size;
+    b->start_address = 0;
+    b->is_allocated = false;
+    b->next = NULL;
+    manager->head = b;
+    return manager;
+}
+
+MemoryManager* initMemoryManager(size_t size, int strategy)
+{
+    MemoryConfig cfg;
+    defaultMemoryConfig(&cfg);
+    cfg.size = size;
+    cfg.strategy = strategy;
+    return createMemoryManager(&cfg);
+}
+
+// Selection functions 
+static MemoryBlock* firstFit(MemoryManager* manager, size_t size) {
+    MemoryBlock* cur = manager->head;
+    while (cur)
+    {
+        if (!cur->is_allocated && cur->size >= size)
+            return cur;
+        cur = cur->next;
+    }
+    return NULL;
+}
+static MemoryBlock* bestFit(MemoryManager* manager, size_t size)
+{
+    MemoryBlock* cur = manager->head; MemoryBlock* best = NULL;
+    while (cur)
+    {
+        if(!cur->is_allocated && cur->size >= size)
+        {
+            if (!best || cur->size < best->size)
+                best = cur;
+        }
+        cur = cur->next;
+    }
+    return best;
+}
+static MemoryBlock* worstFit(MemoryManager* manager, size_t size)
+{
+    MemoryBlock* cur = manager->head; MemoryBlock* worst = NULL;
+    while (cur)
+    { 
+        if (!cur->is_allocated && cur->size >= size)
+        {
+            if (!worst || cur->size > worst->size)
+            worst = cur;
+        }
+        cur = cur->next;
+    }
+    return worst;
+}
+
+// Allocate with splitting, returning the block (NULL on failure)
+MemoryBlock* allocateBlock(MemoryManager* manager, size_t size)
+{
+    if (!manager) return NULL;
+    if (size < manager->min_partition) return NULL;
+    // Real blocks hand out pointers: keep every split point aligned for any type
+    if (manager->base)
+        size = (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+    if (size > manager->free_size) return NULL;
+
+    MemoryBlock* target = NULL;
+    switch (manager->allocation_strategy) {
+        case FIRST_FIT: target = firstFit(manager, size); break;
+        case BEST_FIT: target = bestFit(manager, size); break;
+        case WORST_FIT: target = worstFit(manager, size); break;
+        default: return NULL;
+    }
+    if (!target) return NULL;
+
+    if (target->size > size + manager->min_partition) {
+        MemoryBlock* leftover = (MemoryBlock*)malloc(sizeof(MemoryBlock));
+        if (!leftover) return NULL;
+        leftover->size = target->size - size;
+        leftover->start_address = target->start_address + size;
+        leftover->is_allocated = false;
+        leftover->next = target->next;
+        target->size = size;
+        target->next = leftover;
+    }
+
+    target->is_allocated = true;
+    manager->free_size -= target->size;
+    return target;
+}
+
+void* allocateMemory(MemoryManager* manager, size_t size) 
+{
+    MemoryBlock* b = allocateBlock(manager, size);
+    return b ? blockData(manager, b) : NULL;
+}
+
+size_t blockAddress(const MemoryBlock* block)
+{
+    return block->start_address;
+}
+
+size_t blockSize(const MemoryBlock* block)
+{
+    return block->size;
+}
+
+void* blockData(const MemoryManager* manager, const MemoryBlock* block)
+{
+    if (manager->base) return manager->base + block->start_address;
+    return (void*)(uintptr_t)block->start_address;
+}
+
+/* Deallocate */
+void deallocate(MemoryManager* manager, void* address) 
+{
+    if (!manager) return;
+    size_t addr = manager->base ? (size_t)((unsigned char*)address - manager->base)
+                                : (size_t)(uintptr_t)address;
+    MemoryBlock* cur = manager->head;
+    while (cur) {
+        if (cur->is_allocated && cur->start_address == addr) {
+            cur->is_allocated = false;
+            manager->free_size += cur->size;
+            return;
+        }
+        cur = cur->next;
+    }
+    printf("Error: invalid address %zu\n", addr);
+}
+
+
+void compactMemory(MemoryManager* manager) 
+{
+    if (!manager) return;
+    size_t next_addr = 0;
+    MemoryBlock* cur = manager->head;
+    MemoryBlock* new_head = NULL;
+    MemoryBlock* tail = NULL;
+    MemoryBlock* freeb = NULL;
+
+    // Relocate allocated blocks to front (the nodes are kept, so callers
+    // holding a block see its new address); the first free block is kept
+    // for the hole left at the top and the others are released
+    while (cur) {
+        MemoryBlock* next = cur->next;
+        if (cur->is_allocated) {
+            // blocks are in address order, so data only ever moves down
+            if (manager->base && cur->start_address != next_addr) {
+                memmove(manager->base + next_addr, manager->base + cur->start_address, cur->size);
+                manager->moved_bytes += cur->size;
+            }
+            cur->start_address = next_addr;
+            cur->next = NULL;
+            next_addr += cur->size;
+            if (!new_head) new_head = cur; else tail->next = cur;
+            tail = cur;
+        } else if (!freeb) {
+            freeb = cur;
+        } else {
+            free(cur);
+        }
+        cur = next;
+    }
+
+    // Append a single free block with remaining memory; there is one to
+    // reuse whenever memory is left, so compaction never allocates
+    if (next_addr < manager->total_size) {
+        freeb->size = manager->total_size - next_addr;
+        freeb->start_address = next_addr;
+        freeb->is_allocated = false;
+        freeb->next = NULL;
+        if (!new_head) new_head = freeb; else tail->next = freeb;
+    } else {
+        free(freeb);
+    }
+
+    // Replace old list with new compacted list
+    manager->head = new_head;
+}
+
+// Print layout
+void printMemory(MemoryManager* manager) 
+{
+    MemoryBlock* cur = manager->head;
+    printf("[Memory Layout]: ");
+    while (cur) {
+        printf("[%s | Addr: %zu | Size: %zu] -> ",
+               cur->is_allocated ? "ALLOC" : "FREE ",
+               cur->start_address,
+               cur->size);
+        cur = cur->next;
+    }
+    printf("NULL\n");
+}
+
+// Free the manager and every block it owns
+void destroyMemoryManager(MemoryManager* manager)
+{
+    if (!manager) return;
+    MemoryBlock* cur = manager->head;
+    while (cur) {
+        MemoryBlock* next = cur->next;
+        free(cur);
+        cur = next;
+    }
+    if (manager->base) munmap(manager->base, manager->mapped_size);
+    free(manager);
+}
+
+// Totals for one walk over the block list
+void getMemoryStats(const MemoryManager* manager, MemoryStats* stats)
+{
+    stats->total_size = manager->total_size;
+    stats->free_size = manager->free_size;
+    stats->largest_free = 0;
+    stats->blocks = 0;
+    stats->allocated_blocks = 0;
+    stats->backing = manager->backing;
+    stats->moved_bytes = manager->moved_bytes;
+    for (MemoryBlock* cur = manager->head; cur; cur = cur->next) {
+        stats->blocks++;
+        if (cur->is_allocated) stats->allocated_blocks++;
+        else if (cur->size > stats->largest_free) stats->largest_free = cur->size;
+    }
+}
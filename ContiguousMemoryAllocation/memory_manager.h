@@ -0,0 +1,67 @@
+#ifndef MEMORY_MANAGER_H
+#define MEMORY_MANAGER_H
+
+#include <stddef.h>
+
+// Contiguous memory allocator over an address range [0, size). The range is
+// simulated (addresses are plain offsets) or backed by a private mapping, in
+// which case addresses are real pointers and compaction moves the data.
+// Every manager is independent; nothing is shared between instances.
+
+#define DEFAULT_MEMORY_SIZE 1024
+#define DEFAULT_MIN_PARTITION 64
+
+enum { FIRST_FIT = 1, BEST_FIT = 2, WORST_FIT = 3 };
+
+// BACKING_THP is an ordinary mapping with transparent huge pages requested
+// (madvise); BACKING_HUGETLB falls back to it when no huge pages are
+// reserved, and MemoryStats tells which one was used
+enum { BACKING_SIMULATED = 0, BACKING_MMAP = 1, BACKING_HUGETLB = 2, BACKING_THP = 3 };
+
+typedef struct MemoryManager MemoryManager;
+typedef struct MemoryBlock MemoryBlock;
+
+typedef struct {
+    size_t size;                // units managed
+    int strategy;               // FIRST_FIT, BEST_FIT or WORST_FIT
+    size_t min_partition;       // smallest request, and smallest hole left by a split
+    int backing;                // BACKING_SIMULATED: size is in units, otherwise bytes
+} MemoryConfig;
+
+typedef struct {
+    size_t total_size;
+    size_t free_size;
+    size_t largest_free;        // largest hole
+    size_t blocks;              // list length, allocated and free
+    size_t allocated_blocks;
+    int backing;
+    size_t moved_bytes;         // copied by compaction so far (real backings only)
+} MemoryStats;
+
+void defaultMemoryConfig(MemoryConfig* cfg);
+
+// NULL on an invalid configuration or out of memory
+MemoryManager* createMemoryManager(const MemoryConfig* cfg);
+MemoryManager* initMemoryManager(size_t size, int strategy);
+void destroyMemoryManager(MemoryManager* manager);
+
+// The returned block stays valid until it is freed, also across compaction
+MemoryBlock* allocateBlock(MemoryManager* manager, size_t size);
+size_t blockAddress(const MemoryBlock* block);
+size_t blockSize(const MemoryBlock* block);
+// The block's memory: a pointer into the mapping, or its offset when simulated
+void* blockData(const MemoryManager* manager, const MemoryBlock* block);
+
+// Simulated, the first block lives at address 0 and cannot be told apart from
+// a failure; use allocateBlock when that matters. Real backings return
+// pointers aligned to max_align_t
+void* allocateMemory(MemoryManager* manager, size_t size);
+void deallocate(MemoryManager* manager, void* address);
+
+// Packs the allocated blocks at the bottom; with a real backing their
+// contents move along, so pointers from before must be refreshed
+void compactMemory(MemoryManager* manager);
+void getMemoryStats(const MemoryManager* manager, MemoryStats* stats);
+void printMemory(MemoryManager* manager);
+
+#endif
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+
+#include "ipc_ring.h"
+
+// Defaults
+
+#define NUM_PROCESS_UNITS  8
+#define MAILBOX_CAPACITY   8
+
+
+typedef struct {
+    sem_t empty;
+    sem_t full;
+    sem_t mutex;
+    int head;
+    int tail;
+} mailbox_t;
+
+// Everything below lives in one anonymous MAP_SHARED mapping, so the
+// pointers stay valid in the forked PUs.
+struct ipc_ring {
+    ring_config_t cfg;
+    int window;                 // items in flight, also the result capacity
+
+    mailbox_t *inbox;           // num_units mailboxes
+    pipeline_item_t *slots;     // num_units * mailbox_capacity items
+    mailbox_t *results;         // one queue back to the owner
+    pipeline_item_t *result_slots;
+
+    pid_t *pids;                // owner-side only
+    void *shared;
+    size_t shared_size;
+};
+
+void ring_default_config(ring_config_t *cfg) {
+    cfg->num_units = NUM_PROCESS_UNITS;
+    cfg->mailbox_capacity = MAILBOX_CAPACITY;
+    cfg->pace_us = 0;
+    cfg->verbose = 0;
+}
+
+static int mailbox_init(mailbox_t *box, int capacity) {
+    box->head = box->tail = 0;
+    if (sem_init(&box->empty, 1, capacity) != 0) return -1;
+    if (sem_init(&box->full, 1, 0) != 0) return -1;
+    if (sem_init(&box->mutex, 1, 1) != 0) return -1;
+    return 0;
+}
+
+static void mailbox_put(mailbox_t *box, pipeline_item_t *slots, int capacity,
+                        pipeline_item_t item) {
+
+    sem_wait(&box->empty);
+    sem_wait(&box->mutex);
+
+    slots[box->head] = item;
+    box->head = (box->head + 1) % capacity;
+
+    sem_post(&box->mutex);
+    sem_post(&box->full);
+}
+
+static pipeline_item_t mailbox_take(mailbox_t *box, pipeline_item_t *slots, int capacity) {
+
+    sem_wait(&box->full);
+    sem_wait(&box->mutex);
+
+    pipeline_item_t item = slots[box->tail];
+    box->tail = (box->tail + 1) % capacity;
+
+    sem_post(&box->mutex);
+    sem_post(&box->empty);
+
+    return item;
+}
+
+static pipeline_item_t *inbox_slots(ipc_ring_t *ring, int pu_id) {
+    return ring->slots + (size_t)pu_id * ring->cfg.mailbox_capacity;
+}
+
+// Processing unit: forward items around the ring until the -1 sentinel
+static void run_unit(ipc_ring_t *ring, int pu_id) {
+
+    int capacity = ring->cfg.mailbox_capacity;
+    if (ring->cfg.verbose)
+        printf("[PU %d] started\n", pu_id);
+
+    while (1) {
+
+        pipeline_item_t item =
+            mailbox_take(&ring->inbox[pu_id], inbox_slots(ring, pu_id), capacity);
+
+        if (item.counter == -1)
+            break;
+
+        item.value += pu_id;
+        item.counter--;
+
+        if (item.counter > 0) {
+
+            int next_pu = (pu_id + 1) % ring->cfg.num_units;
+            mailbox_put(&ring->inbox[next_pu], inbox_slots(ring, next_pu), capacity, item);
+
+            if (ring->cfg.verbose)
+                printf("[PU %d] forwarded value=%d counter=%d to PU %d\n",
+                       pu_id, item.value, item.counter, next_pu);
+        } else {
+
+            mailbox_put(ring->results, ring->result_slots, ring->window, item);
+
+            if (ring->cfg.verbose)
+                printf("[PU %d] finished value=%d\n", pu_id, item.value);
+        }
+    }
+}
+
+static void send_sentinels(ipc_ring_t *ring, int units) {
+    for (int i = 0; i < units; i++)
+        mailbox_put(&ring->inbox[i], inbox_slots(ring, i), ring->cfg.mailbox_capacity,
+                    (pipeline_item_t){ .counter = -1 });
+    for (int i = 0; i < units; i++)
+        waitpid(ring->pids[i], NULL, 0);
+}
+
+static void release(ipc_ring_t *ring) {
+    for (int i = 0; i < ring->cfg.num_units; i++) {
+        sem_destroy(&ring->inbox[i].empty);
+        sem_destroy(&ring->inbox[i].full);
+        sem_destroy(&ring->inbox[i].mutex);
+    }
+    sem_destroy(&ring->results->empty);
+    sem_destroy(&ring->results->full);
+    sem_destroy(&ring->results->mutex);
+    munmap(ring->shared, ring->shared_size);
+    free(ring->pids);
+    free(ring);
+}
+
+ipc_ring_t *ring_create(const ring_config_t *cfg) {
+
+    if (cfg->num_units < 1 || cfg->mailbox_capacity < 1 || cfg->pace_us < 0) {
+        fprintf(stderr, "ring: need at least one PU and one mailbox slot\n");
+        return NULL;
+    }
+
+    ipc_ring_t *ring = calloc(1, sizeof(ipc_ring_t));
+    if (!ring) return NULL;
+    ring->cfg = *cfg;
+
+    // Below a full ring plus one item per PU, so the PUs can never all
+    // block forwarding into full inboxes
+    ring->window = cfg->num_units * cfg->mailbox_capacity;
+
+    // Shared Memory Setup
+
+    size_t units = cfg->num_units;
+    size_t boxes = (units + 1) * sizeof(mailbox_t);
+    size_t items = (units * cfg->mailbox_capacity + ring->window) * sizeof(pipeline_item_t);
+    ring->shared_size = boxes + items;
+    ring->shared = mmap(NULL, ring->shared_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ring->pids = calloc(units, sizeof(pid_t));
+    if (ring->shared == MAP_FAILED || !ring->pids) {
+        perror("ring");
+        if (ring->shared != MAP_FAILED) munmap(ring->shared, ring->shared_size);
+        free(ring->pids);
+        free(ring);
+        return NULL;
+    }
+
+    ring->inbox = ring->shared;
+    ring->results = ring->inbox + units;
+    ring->slots = (pipeline_item_t *)(ring->results + 1);
+    ring->result_slots = ring->slots + units * cfg->mailbox_capacity;
+
+    // Mailbox Semaphores
+
+    int ok = mailbox_init(ring->results, ring->window) == 0;
+    for (size_t i = 0; ok && i < units; i++)
+        ok = mailbox_init(&ring->inbox[i], cfg->mailbox_capacity) == 0;
+    if (!ok) {
+        perror("ring: sem_init");
+        release(ring);
+        return NULL;
+    }
+
+    // Spawn Processing Units
+
+    fflush(stdout);
+    for (int pu_id = 0; pu_id < cfg->num_units; pu_id++) {
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_unit(ring, pu_id);
+            fflush(stdout);
+            _exit(0);
+        }
+        if (pid < 0) {
+            perror("ring: fork");
+            send_sentinels(ring, pu_id);
+            release(ring);
+            return NULL;
+        }
+        ring->pids[pu_id] = pid;
+    }
+
+    return ring;
+}
+
+int ring_window(const ipc_ring_t *ring) {
+    return ring->window;
+}
+
+int ring_process(ipc_ring_t *ring, const pipeline_item_t *items, int count,
+                 pipeline_item_t *results) {
+
+    for (int i = 0; i < count; i++)
+        if (items[i].counter < 1)
+            return -1;
+
+    int units = ring->cfg.num_units;
+    int collected = 0;
+    for (int i = 0; i < count; i++) {
+
+        // Keep the window: make room by collecting a result first
+        if (i - collected == ring->window) {
+            results[collected++] =
+                mailbox_take(ring->results, ring->result_slots, ring->window);
+        }
+
+        int target_pu = ((items[i].value % units) + units) % units;
+        mailbox_put(&ring->inbox[target_pu], inbox_slots(ring, target_pu),
+                    ring->cfg.mailbox_capacity, items[i]);
+
+        if (ring->cfg.pace_us > 0)
+            usleep(ring->cfg.pace_us);
+    }
+
+    while (collected < count)
+        results[collected++] =
+            mailbox_take(ring->results, ring->result_slots, ring->window);
+
+    return collected;
+}
+
+void ring_destroy(ipc_ring_t *ring) {
+    if (!ring) return;
+    send_sentinels(ring, ring->cfg.num_units);
+    release(ring);
+}
@@ -0,0 +1,43 @@
+#ifndef IPC_RING_H
+#define IPC_RING_H
+
+// A ring of processing units (PUs), each a forked child with its own mailbox
+// in shared memory. An item visits PU after PU; every PU adds its id to the
+// value and decrements the counter, and the PU that brings the counter to
+// zero hands the item back to the owner.
+//
+// Rings use anonymous shared memory and unnamed process-shared semaphores,
+// so any number of them can exist side by side in one process.
+
+typedef struct ipc_ring ipc_ring_t;
+
+typedef struct {
+    int value;
+    int counter;                // remaining hops, must be positive
+} pipeline_item_t;
+
+typedef struct {
+    int num_units;              // processing units (child processes)
+    int mailbox_capacity;       // items per PU inbox
+    int pace_us;                // pause after each item sent, 0 for none
+    int verbose;                // PUs print every start, forward and finish
+} ring_config_t;
+
+void ring_default_config(ring_config_t *cfg);
+
+// Forks the PUs; NULL on failure
+ipc_ring_t *ring_create(const ring_config_t *cfg);
+
+// Sends items[i] to PU (value % num_units) and collects `count` finished
+// items into results[] in completion order. A ring serves any number of
+// calls. Returns the number of results, or -1 if an item is invalid.
+int ring_process(ipc_ring_t *ring, const pipeline_item_t *items, int count,
+                 pipeline_item_t *results);
+
+// Items the owner keeps in the ring at once
+int ring_window(const ipc_ring_t *ring);
+
+// Stops the PUs, waits for them and releases the shared memory
+void ring_destroy(ipc_ring_t *ring);
+
+#endif
@@ -0,0 +1,1275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <regex.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stddef.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "log_analyzer.h"
+
+//  Constants & Config 
+#define MAX_LINE 2048
+
+#define PROTO_LOG "LOG:"
+#define PROTO_BUG "BUG:"
+
+//  Compressed input 
+#define MAX_CHUNKS 16           // parallel workers per compressed file
+#define READ_BUF (1 << 17)
+
+enum { FORMAT_PLAIN, FORMAT_GZIP, FORMAT_ZSTD };
+
+//  On-disk index 
+#define INDEX_SUFFIX ".idx"
+#define INDEX_MAGIC 0x5844494cU     // "LIDX"
+#define INDEX_VERSION 1
+#define INDEX_BLOCK_LINES 64
+
+//  Aggregation (summary mode) 
+#define AGG_BUCKETS 4096        // distinct minutes tracked per worker
+#define CMS_DEPTH 4
+#define CMS_WIDTH 2048
+#define HLL_BITS 12
+#define HLL_REGISTERS (1 << HLL_BITS)
+#define MAX_MSG 256
+
+
+typedef struct
+{
+    long minute;     // packed as YYYYMMDDHHMM, -1 when the slot is empty
+    int count[NUM_SEVERITIES];
+} TimeBucket;
+
+typedef struct
+{
+    uint64_t hash;
+    unsigned int count;
+    char message[MAX_MSG];
+} TopEntry;
+
+// Partial result of one worker. Every field merges with sum/max, so the
+// parent combines workers without ever seeing the individual lines.
+typedef struct
+{
+    TimeBucket buckets[AGG_BUCKETS];
+    int dropped_buckets;
+    long totals[NUM_SEVERITIES];
+    unsigned int cms[CMS_DEPTH][CMS_WIDTH];
+    unsigned char hll[HLL_REGISTERS];
+    TopEntry top[MAX_TOP_K];   // min-heap on count
+    int top_count;
+} Aggregate;
+
+typedef struct
+{
+    char filename[256];
+    char filepath[MAX_PATH];
+    char dependency[256];
+    int bug_count;
+    int format;
+    int chunk_count;                    // one worker per chunk
+    off_t chunk_start[MAX_CHUNKS + 1];  // compressed offsets, chunk_start[chunk_count] = size
+    int agg_slot;                       // first Aggregate slot of this file
+    int pipe_fd[MAX_CHUNKS][2];
+    pid_t pid[MAX_CHUNKS];
+} LogFile;
+
+// Sidecar "<log>.idx": a header followed by one IndexBlock per 64 lines.
+// Lines are the same pieces the worker's scanner sees (the dependency line
+// is not indexed), so an indexed query reports exactly what a scan would.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t file_size;     // the log this index was built from
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t block_count;
+} IndexHeader;
+
+typedef struct
+{
+    uint64_t offset;                            // file offset of the first line
+    uint32_t bytes;                             // length of the block in the log
+    uint32_t line_count;
+    int64_t min_ts;                             // over valid lines, -1 if none
+    int64_t max_ts;
+    uint64_t severity[NUM_SEVERITIES];          // bit i: line i has that severity
+    uint64_t invalid;                           // bit i: line i is malformed
+    uint32_t line_offset[INDEX_BLOCK_LINES];    // relative to offset
+} IndexBlock;
+
+typedef struct
+{
+    FILE *fp;
+    char tmp_path[MAX_PATH + 16];
+    IndexHeader header;
+    IndexBlock block;
+} IndexWriter;
+
+// Streams decompressed bytes of one chunk. Frames (gzip members, zstd frames)
+// are decoded one after another; `boundary` marks the decompressed offset of
+// the first frame at or past `end`, so a worker knows where its range stops.
+typedef struct
+{
+    int format;
+    FILE *fp;                       // plain text
+    const unsigned char *src;       // mapped compressed file
+    size_t src_size;
+    size_t src_pos;
+    size_t end;
+    int in_frame;
+    z_stream zs;
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *zd;
+#endif
+    char buf[READ_BUF];
+    size_t buf_len;
+    size_t buf_pos;
+    unsigned long long produced;    // decompressed bytes written to buf so far
+    unsigned long long boundary;
+    int eof;
+} LogReader;
+
+// Everything one analyzer owns; nothing is shared between analyzers.
+struct LogAnalyzer
+{
+    LogConfig cfg;
+    regex_t regex;
+    LogFile *files;             // of the last run, in dependency order
+    int file_count;
+    int file_capacity;
+    Aggregate *aggregates;      // one slot per chunk, shared with the workers
+};
+
+const char *SEVERITIES[NUM_SEVERITIES] = {"ERROR", "INFO", "WARNING"};
+
+const char *LOG_PATTERN ="^(ERROR|INFO|WARNING) \\| [0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2} \\| (.+)$";
+
+static void trim_newline(char *s)
+{
+    int l = strlen(s);
+    while (l > 0 && (s[l - 1] == '\n' || s[l - 1] == '\r'))
+        s[--l] = 0;
+}
+
+static int matches_severity(const char *line, const char *severity)
+{
+    return strncmp(line, severity, strlen(severity)) == 0;
+}
+
+static int severity_index(const char *line)
+{
+    for (int i = 0; i < NUM_SEVERITIES; i++)
+        if (matches_severity(line, SEVERITIES[i]))
+            return i;
+    return -1;
+}
+
+//  Aggregation helpers 
+
+static uint64_t hash_message(const char *s, size_t len)
+{
+    uint64_t h = 1469598103934665603ULL;    // FNV-1a
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;                            // final avalanche for the HLL bits
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void init_aggregate(Aggregate *agg)
+{
+    memset(agg, 0, sizeof(Aggregate));
+    for (int i = 0; i < AGG_BUCKETS; i++)
+        agg->buckets[i].minute = -1;
+}
+
+// "YYYY-MM-DD HH:MM:SS" -> YYYYMMDDHHMMSS
+long long parse_timestamp(const char *ts)
+{
+    int y, mo, d, h, mi, s;
+    if (sscanf(ts, "%4d-%2d-%2d %2d:%2d:%2d", &y, &mo, &d, &h, &mi, &s) != 6)
+        return -1;
+    return ((((y * 100LL + mo) * 100 + d) * 100 + h) * 100 + mi) * 100 + s;
+}
+
+// Timestamp of a line already validated by the regex.
+static long long line_timestamp(const char *line, int sev)
+{
+    return parse_timestamp(line + strlen(SEVERITIES[sev]) + 3);
+}
+
+static int in_time_range(long long ts, const LogConfig *cfg)
+{
+    return (cfg->from_ts < 0 || ts >= cfg->from_ts) &&
+           (cfg->to_ts < 0 || ts <= cfg->to_ts);
+}
+
+static TimeBucket *find_bucket(TimeBucket buckets[], long minute)
+{
+    unsigned int slot = (unsigned int)((uint64_t)minute * 0x9E3779B97F4A7C15ULL >> 52) % AGG_BUCKETS;
+    for (int probe = 0; probe < AGG_BUCKETS; probe++)
+    {
+        TimeBucket *b = &buckets[(slot + probe) % AGG_BUCKETS];
+        if (b->minute == minute)
+            return b;
+        if (b->minute == -1)
+        {
+            b->minute = minute;
+            return b;
+        }
+    }
+    return NULL;    // table full
+}
+
+static unsigned int cms_add(unsigned int cms[CMS_DEPTH][CMS_WIDTH], uint64_t h, unsigned int n)
+{
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32);
+    unsigned int est = 0;
+    for (int r = 0; r < CMS_DEPTH; r++)
+    {
+        unsigned int *c = &cms[r][(h1 + r * h2) % CMS_WIDTH];
+        *c += n;
+        if (r == 0 || *c < est)
+            est = *c;
+    }
+    return est;
+}
+
+static unsigned int cms_estimate(unsigned int cms[CMS_DEPTH][CMS_WIDTH], uint64_t h)
+{
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32);
+    unsigned int est = 0;
+    for (int r = 0; r < CMS_DEPTH; r++)
+    {
+        unsigned int c = cms[r][(h1 + r * h2) % CMS_WIDTH];
+        if (r == 0 || c < est)
+            est = c;
+    }
+    return est;
+}
+
+static void hll_add(unsigned char hll[], uint64_t h)
+{
+    int idx = h >> (64 - HLL_BITS);
+    uint64_t rest = h << HLL_BITS;
+    unsigned char rank = rest ? __builtin_clzll(rest) + 1 : 64 - HLL_BITS + 1;
+    if (rank > hll[idx])
+        hll[idx] = rank;
+}
+
+static double hll_estimate(const unsigned char hll[])
+{
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++)
+    {
+        sum += 1.0 / (double)(1ULL << hll[i]);
+        if (hll[i] == 0)
+            zeros++;
+    }
+    double m = HLL_REGISTERS;
+    double est = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (est <= 2.5 * m && zeros)
+        est = m * log(m / zeros);   // small-range correction (linear counting)
+    return est;
+}
+
+static void heap_sift_down(TopEntry heap[], int n, int i)
+{
+    while (1)
+    {
+        int l = 2 * i + 1, r = l + 1, min = i;
+        if (l < n && heap[l].count < heap[min].count)
+            min = l;
+        if (r < n && heap[r].count < heap[min].count)
+            min = r;
+        if (min == i)
+            return;
+        TopEntry tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+static void heap_sift_up(TopEntry heap[], int i)
+{
+    while (i > 0 && heap[(i - 1) / 2].count > heap[i].count)
+    {
+        TopEntry tmp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+}
+
+// Keep the k messages with the largest sketch estimate in a min-heap.
+static void topk_offer(TopEntry heap[], int *n, int k, uint64_t h,
+                       const char *msg, size_t len, unsigned int est)
+{
+    for (int i = 0; i < *n; i++)
+    {
+        if (heap[i].hash == h)
+        {
+            heap[i].count = est;    // estimates only grow
+            heap_sift_down(heap, *n, i);
+            return;
+        }
+    }
+
+    if (*n < k)
+    {
+        TopEntry *e = &heap[(*n)++];
+        e->hash = h;
+        e->count = est;
+        snprintf(e->message, MAX_MSG, "%.*s", (int)len, msg);
+        heap_sift_up(heap, *n - 1);
+    }
+    else if (k > 0 && est > heap[0].count)
+    {
+        heap[0].hash = h;
+        heap[0].count = est;
+        snprintf(heap[0].message, MAX_MSG, "%.*s", (int)len, msg);
+        heap_sift_down(heap, *n, 0);
+    }
+}
+
+static void aggregate_line(Aggregate *agg, const char *line, const regmatch_t m[],
+                           const char *target_severity, int top_k)
+{
+    int sev = severity_index(line);
+    long minute = line_timestamp(line, sev) / 100;
+    agg->totals[sev]++;
+
+    TimeBucket *b = find_bucket(agg->buckets, minute);
+    if (b)
+        b->count[sev]++;
+    else
+        agg->dropped_buckets++;
+
+    if (!matches_severity(line, target_severity))
+        return;
+
+    const char *msg = line + m[2].rm_so;
+    size_t len = m[2].rm_eo - m[2].rm_so;
+    uint64_t h = hash_message(msg, len);
+    unsigned int est = cms_add(agg->cms, h, 1);
+    hll_add(agg->hll, h);
+    topk_offer(agg->top, &agg->top_count, top_k, h, msg, len, est);
+}
+
+// Parent side: fold src into dst. Heavy hitters are re-ranked against the
+// merged sketch so a message spread over many files still surfaces.
+static void merge_aggregate(Aggregate *dst, const Aggregate *src, int top_k)
+{
+    for (int i = 0; i < AGG_BUCKETS; i++)
+    {
+        const TimeBucket *sb = &src->buckets[i];
+        if (sb->minute == -1)
+            continue;
+        TimeBucket *db = find_bucket(dst->buckets, sb->minute);
+        if (!db)
+        {
+            dst->dropped_buckets++;
+            continue;
+        }
+        for (int s = 0; s < NUM_SEVERITIES; s++)
+            db->count[s] += sb->count[s];
+    }
+    dst->dropped_buckets += src->dropped_buckets;
+
+    for (int s = 0; s < NUM_SEVERITIES; s++)
+        dst->totals[s] += src->totals[s];
+    for (int r = 0; r < CMS_DEPTH; r++)
+        for (int c = 0; c < CMS_WIDTH; c++)
+            dst->cms[r][c] += src->cms[r][c];
+    for (int i = 0; i < HLL_REGISTERS; i++)
+        if (src->hll[i] > dst->hll[i])
+            dst->hll[i] = src->hll[i];
+
+    // Candidates are the union of both heaps, rescored with the merged sketch.
+    TopEntry candidates[2 * MAX_TOP_K];
+    int n = 0;
+    for (int i = 0; i < dst->top_count; i++)
+        candidates[n++] = dst->top[i];
+    for (int i = 0; i < src->top_count; i++)
+        candidates[n++] = src->top[i];
+
+    dst->top_count = 0;
+    for (int i = 0; i < n; i++)
+        topk_offer(dst->top, &dst->top_count, top_k, candidates[i].hash,
+                   candidates[i].message, strlen(candidates[i].message),
+                   cms_estimate(dst->cms, candidates[i].hash));
+}
+
+static int compare_bucket(const void *a, const void *b)
+{
+    long x = ((const TimeBucket *)a)->minute, y = ((const TimeBucket *)b)->minute;
+    return (x > y) - (x < y);
+}
+
+static int compare_top(const void *a, const void *b)
+{
+    unsigned int x = ((const TopEntry *)a)->count, y = ((const TopEntry *)b)->count;
+    return (x < y) - (x > y);
+}
+
+static void write_summary(FILE *out, Aggregate *agg, const LogConfig *cfg)
+{
+    fprintf(out, "== Summary ==\n");
+    fprintf(out, "Lines:");
+    for (int s = 0; s < NUM_SEVERITIES; s++)
+        fprintf(out, " %s=%ld", SEVERITIES[s], agg->totals[s]);
+    fprintf(out, "\n");
+    fprintf(out, "Distinct %s messages (approx): %.0f\n",
+            cfg->target_severity, hll_estimate(agg->hll));
+
+    qsort(agg->top, agg->top_count, sizeof(TopEntry), compare_top);
+    fprintf(out, "\nTop %d %s messages:\n", cfg->top_k, cfg->target_severity);
+    for (int i = 0; i < agg->top_count; i++)
+        fprintf(out, "%8u  %s\n", agg->top[i].count, agg->top[i].message);
+
+    qsort(agg->buckets, AGG_BUCKETS, sizeof(TimeBucket), compare_bucket);
+    fprintf(out, "\nPer-minute counts:\n");
+    for (int i = 0; i < AGG_BUCKETS; i++)
+    {
+        TimeBucket *b = &agg->buckets[i];
+        if (b->minute == -1)
+            continue;
+        long m = b->minute;
+        int total = 0;
+        for (int s = 0; s < NUM_SEVERITIES; s++)
+            total += b->count[s];
+        fprintf(out, "%04ld-%02ld-%02ld %02ld:%02ld ",
+                m / 100000000, m / 1000000 % 100, m / 10000 % 100,
+                m / 100 % 100, m % 100);
+        for (int s = 0; s < NUM_SEVERITIES; s++)
+            fprintf(out, " %s=%d", SEVERITIES[s], b->count[s]);
+        fprintf(out, "  error rate %.2f%%\n",
+                total ? 100.0 * b->count[0] / total : 0.0);
+    }
+    if (agg->dropped_buckets)
+        fprintf(out, "(%d lines outside the %d tracked minutes)\n",
+                agg->dropped_buckets, AGG_BUCKETS);
+    fprintf(out, "\n");
+}
+
+//  Compressed input 
+
+static int detect_format(const char *path)
+{
+    unsigned char magic[4] = {0};
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return FORMAT_PLAIN;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return FORMAT_GZIP;
+    if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        return FORMAT_ZSTD;
+    return FORMAT_PLAIN;
+}
+
+static int has_suffix(const char *name, const char *suffix)
+{
+    size_t n = strlen(name), s = strlen(suffix);
+    return n >= s && strcmp(name + n - s, suffix) == 0;
+}
+
+static int is_log_name(const char *name)
+{
+    if (has_suffix(name, INDEX_SUFFIX) || has_suffix(name, INDEX_SUFFIX ".tmp"))
+        return 0;
+    return strstr(name, ".txt") || has_suffix(name, ".gz") || has_suffix(name, ".zst");
+}
+
+// "auth.txt.gz" satisfies a dependency on "auth.txt".
+static int same_log(const char *dependency, const char *filename)
+{
+    size_t n = strlen(dependency);
+    if (strncmp(dependency, filename, n) != 0)
+        return 0;
+    return filename[n] == 0 || strcmp(filename + n, ".gz") == 0 ||
+           strcmp(filename + n, ".zst") == 0;
+}
+
+// Offset just past the frame that starts at pos, or 0 if it cannot be
+// located without decompressing (plain gzip members carry no length).
+static size_t next_frame(int format, const unsigned char *src, size_t size, size_t pos)
+{
+    if (format == FORMAT_GZIP)
+    {
+        // BGZF (bgzip): FEXTRA with a "BC" subfield holding the block size.
+        const unsigned char *h = src + pos;
+        if (size - pos < 18 || h[0] != 0x1f || h[1] != 0x8b || !(h[3] & 4))
+            return 0;
+        if (h[12] != 'B' || h[13] != 'C' || h[14] != 2 || h[15] != 0)
+            return 0;
+        size_t bsize = (h[16] | (h[17] << 8)) + 1;
+        return pos + bsize <= size ? pos + bsize : 0;
+    }
+#ifdef HAVE_ZSTD
+    if (format == FORMAT_ZSTD)
+    {
+        size_t n = ZSTD_findFrameCompressedSize(src + pos, size - pos);
+        return ZSTD_isError(n) ? 0 : pos + n;
+    }
+#endif
+    return 0;
+}
+
+// Split a compressed file into up to `jobs` chunks on frame boundaries,
+// balancing compressed bytes. Unsplittable inputs get a single chunk.
+static void plan_chunks(LogFile *f, int jobs)
+{
+    struct stat st;
+    f->chunk_count = 1;
+    f->chunk_start[0] = 0;
+    f->chunk_start[1] = 0;
+
+    if (stat(f->filepath, &st) != 0)
+        return;
+    f->chunk_start[1] = st.st_size;
+    if (f->format == FORMAT_PLAIN || jobs < 2 || st.st_size == 0)
+        return;
+
+    int fd = open(f->filepath, O_RDONLY);
+    if (fd < 0)
+        return;
+    size_t size = st.st_size;
+    const unsigned char *src = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (src == MAP_FAILED)
+        return;
+
+    size_t target = size / jobs;
+    size_t pos = 0;
+    int chunks = 1;
+    while (pos < size)
+    {
+        size_t next = next_frame(f->format, src, size, pos);
+        if (next == 0)
+        {
+            chunks = 1;     // not independently decodable, keep one worker
+            break;
+        }
+        pos = next;
+        if (pos < size && chunks < jobs && pos >= chunks * target)
+            f->chunk_start[chunks++] = pos;
+    }
+    munmap((void *)src, size);
+
+    f->chunk_count = chunks;
+    f->chunk_start[chunks] = size;
+}
+
+static int reader_open(LogReader *r, const LogFile *f, int chunk)
+{
+    memset(r, 0, offsetof(LogReader, buf));
+    r->buf_len = r->buf_pos = 0;
+    r->produced = 0;
+    r->boundary = ~0ULL;
+    r->eof = 0;
+    r->format = f->format;
+
+    if (f->format == FORMAT_PLAIN)
+    {
+        r->fp = fopen(f->filepath, "r");
+        return r->fp ? 0 : -1;
+    }
+
+#ifndef HAVE_ZSTD
+    if (f->format == FORMAT_ZSTD)
+    {
+        fprintf(stderr, "%s: zstd support not built in (compile with -DHAVE_ZSTD -lzstd)\n",
+                f->filename);
+        return -1;
+    }
+#endif
+
+    int fd = open(f->filepath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    r->src_size = f->chunk_start[f->chunk_count];
+    r->src = r->src_size ? mmap(NULL, r->src_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (r->src == MAP_FAILED)
+        return -1;
+    if (r->src)
+        madvise((void *)r->src, r->src_size, MADV_SEQUENTIAL);
+    r->src_pos = f->chunk_start[chunk];
+    r->end = f->chunk_start[chunk + 1];
+
+    if (f->format == FORMAT_GZIP)
+        return inflateInit2(&r->zs, 15 + 16) == Z_OK ? 0 : -1;
+#ifdef HAVE_ZSTD
+    r->zd = ZSTD_createDCtx();
+    return r->zd ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+static void reader_close(LogReader *r)
+{
+    if (r->fp)
+        fclose(r->fp);
+    if (r->format == FORMAT_GZIP)
+        inflateEnd(&r->zs);
+#ifdef HAVE_ZSTD
+    if (r->zd)
+        ZSTD_freeDCtx(r->zd);
+#endif
+    if (r->src)
+        munmap((void *)r->src, r->src_size);
+}
+
+// Refill buf with the next decompressed bytes. Returns 0 at end of input.
+static int reader_fill(LogReader *r)
+{
+    r->buf_len = r->buf_pos = 0;
+    while (r->buf_len == 0 && !r->eof)
+    {
+        if (r->format == FORMAT_PLAIN)
+        {
+            r->buf_len = fread(r->buf, 1, READ_BUF, r->fp);
+            if (r->buf_len == 0)
+                r->eof = 1;
+            r->produced += r->buf_len;
+            break;
+        }
+
+        if (!r->in_frame)
+        {
+            if (r->src_pos >= r->src_size)
+            {
+                r->eof = 1;
+                break;
+            }
+            if (r->src_pos >= r->end && r->boundary == ~0ULL)
+                r->boundary = r->produced;
+            if (r->format == FORMAT_GZIP)
+                inflateReset(&r->zs);
+            r->in_frame = 1;
+        }
+
+        int frame_done = 0;
+        if (r->format == FORMAT_GZIP)
+        {
+            r->zs.next_in = (unsigned char *)r->src + r->src_pos;
+            r->zs.avail_in = r->src_size - r->src_pos;
+            r->zs.next_out = (unsigned char *)r->buf;
+            r->zs.avail_out = READ_BUF;
+            int ret = inflate(&r->zs, Z_NO_FLUSH);
+            r->src_pos = r->src_size - r->zs.avail_in;
+            r->buf_len = READ_BUF - r->zs.avail_out;
+            if (ret == Z_STREAM_END)
+                frame_done = 1;
+            else if (ret != Z_OK && ret != Z_BUF_ERROR)
+                r->eof = 1;     // trailing garbage or a corrupt member
+            else if (r->buf_len == 0 && r->zs.avail_in == 0)
+                r->eof = 1;     // truncated member
+        }
+#ifdef HAVE_ZSTD
+        else
+        {
+            ZSTD_inBuffer in = {r->src, r->src_size, r->src_pos};
+            ZSTD_outBuffer out = {r->buf, READ_BUF, 0};
+            size_t ret = ZSTD_decompressStream(r->zd, &out, &in);
+            r->src_pos = in.pos;
+            r->buf_len = out.pos;
+            if (ZSTD_isError(ret))
+                r->eof = 1;
+            else if (ret == 0)
+                frame_done = 1;
+            else if (out.pos == 0 && in.pos == in.size)
+                r->eof = 1;
+        }
+#endif
+        if (frame_done)
+            r->in_frame = 0;
+        r->produced += r->buf_len;
+    }
+    return r->buf_len > 0;
+}
+
+// fgets() over the decompressed stream. *line_end receives the decompressed
+// offset just past the returned bytes.
+static int reader_gets(LogReader *r, char *line, size_t size, unsigned long long *line_end)
+{
+    size_t n = 0;
+    while (n + 1 < size)
+    {
+        if (r->buf_pos == r->buf_len && !reader_fill(r))
+            break;
+        char c = r->buf[r->buf_pos++];
+        line[n++] = c;
+        if (c == '\n')
+            break;
+    }
+    line[n] = 0;
+    *line_end = r->produced - (r->buf_len - r->buf_pos);
+    return n > 0;
+}
+
+//  On-disk index 
+
+// Opens the sidecar index of f if it still describes the log on disk.
+// Returns NULL when it is missing, corrupt or stale (size or mtime changed).
+static FILE *index_open(const LogFile *f, IndexHeader *h)
+{
+    char path[MAX_PATH + 8];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s%s", f->filepath, INDEX_SUFFIX);
+
+    if (stat(f->filepath, &st) != 0)
+        return NULL;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    if (fread(h, sizeof(*h), 1, fp) != 1 ||
+        h->magic != INDEX_MAGIC || h->version != INDEX_VERSION ||
+        h->file_size != (uint64_t)st.st_size ||
+        h->mtime_sec != st.st_mtim.tv_sec || h->mtime_nsec != st.st_mtim.tv_nsec)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+static int index_writer_open(IndexWriter *w, const LogFile *f)
+{
+    struct stat st;
+    if (stat(f->filepath, &st) != 0)
+        return -1;
+
+    snprintf(w->tmp_path, sizeof(w->tmp_path), "%s%s.tmp", f->filepath, INDEX_SUFFIX);
+    w->fp = fopen(w->tmp_path, "wb");
+    if (!w->fp)
+        return -1;
+
+    memset(&w->header, 0, sizeof(w->header));
+    w->header.magic = INDEX_MAGIC;
+    w->header.version = INDEX_VERSION;
+    w->header.file_size = st.st_size;
+    w->header.mtime_sec = st.st_mtim.tv_sec;
+    w->header.mtime_nsec = st.st_mtim.tv_nsec;
+    memset(&w->block, 0, sizeof(w->block));
+
+    // Header is rewritten with the final block count on close.
+    return fwrite(&w->header, sizeof(w->header), 1, w->fp) == 1 ? 0 : -1;
+}
+
+static void index_flush_block(IndexWriter *w)
+{
+    if (w->block.line_count == 0)
+        return;
+    fwrite(&w->block, sizeof(w->block), 1, w->fp);
+    w->header.block_count++;
+    memset(&w->block, 0, sizeof(w->block));
+}
+
+// sev is the severity index of a valid line, -1 for a malformed one.
+static void index_add_line(IndexWriter *w, uint64_t offset, size_t len, int sev, long long ts)
+{
+    IndexBlock *b = &w->block;
+    if (b->line_count == 0)
+    {
+        b->offset = offset;
+        b->min_ts = b->max_ts = -1;
+    }
+
+    int i = b->line_count++;
+    b->line_offset[i] = offset - b->offset;
+    b->bytes = offset + len - b->offset;
+
+    if (sev < 0)
+    {
+        b->invalid |= 1ULL << i;
+    }
+    else
+    {
+        b->severity[sev] |= 1ULL << i;
+        if (b->min_ts < 0 || ts < b->min_ts)
+            b->min_ts = ts;
+        if (ts > b->max_ts)
+            b->max_ts = ts;
+    }
+
+    if (b->line_count == INDEX_BLOCK_LINES)
+        index_flush_block(w);
+}
+
+// Publish the index atomically so concurrent queries never see half of it.
+static void index_writer_close(IndexWriter *w, const LogFile *f)
+{
+    char path[MAX_PATH + 8];
+    index_flush_block(w);
+
+    int ok = fseek(w->fp, 0, SEEK_SET) == 0 &&
+             fwrite(&w->header, sizeof(w->header), 1, w->fp) == 1;
+    ok = (fclose(w->fp) == 0) && ok;
+
+    snprintf(path, sizeof(path), "%s%s", f->filepath, INDEX_SUFFIX);
+    if (!ok || rename(w->tmp_path, path) != 0)
+        unlink(w->tmp_path);
+}
+
+// Mask of severities selected by the target prefix (all when aggregating).
+static unsigned int wanted_severities(const LogConfig *cfg)
+{
+    unsigned int mask = 0;
+    for (int s = 0; s < NUM_SEVERITIES; s++)
+        if (cfg->aggregate || strncmp(SEVERITIES[s], cfg->target_severity,
+                                      strlen(cfg->target_severity)) == 0)
+            mask |= 1U << s;
+    return mask;
+}
+
+// Answer the query from the index: blocks without a wanted severity or
+// outside the time range are skipped, the rest is fetched with one pread.
+static int scan_indexed(const LogFile *f, FILE *idx, const IndexHeader *h,
+                        const LogConfig *cfg, const regex_t *regex, Aggregate *agg, int out_fd)
+{
+    int fd = open(f->filepath, O_RDONLY);
+    char *buf = malloc(INDEX_BLOCK_LINES * MAX_LINE);
+    if (fd < 0 || !buf)
+        _exit(1);
+
+    unsigned int wanted = wanted_severities(cfg);
+    regmatch_t m[3];
+    char line[MAX_LINE];
+    int bugs = 0;
+    IndexBlock b;
+
+    for (uint64_t n = 0; n < h->block_count && fread(&b, sizeof(b), 1, idx) == 1; n++)
+    {
+        bugs += __builtin_popcountll(b.invalid);
+
+        uint64_t lines = 0;
+        for (int s = 0; s < NUM_SEVERITIES; s++)
+            if (wanted & (1U << s))
+                lines |= b.severity[s];
+        if (!lines)
+            continue;
+        if (cfg->from_ts >= 0 && b.max_ts < cfg->from_ts)
+            continue;
+        if (cfg->to_ts >= 0 && b.min_ts > cfg->to_ts)
+            continue;
+
+        if (pread(fd, buf, b.bytes, b.offset) != (ssize_t)b.bytes)
+            break;
+
+        while (lines)
+        {
+            int i = __builtin_ctzll(lines);
+            lines &= lines - 1;
+
+            uint32_t start = b.line_offset[i];
+            uint32_t end = (i + 1 < (int)b.line_count) ? b.line_offset[i + 1] : b.bytes;
+            memcpy(line, buf + start, end - start);
+            line[end - start] = 0;
+            trim_newline(line);
+
+            int sev = severity_index(line);
+            if (!in_time_range(line_timestamp(line, sev), cfg))
+                continue;
+            if (agg)
+            {
+                if (regexec(regex, line, 3, m, 0) == 0)
+                    aggregate_line(agg, line, m, cfg->target_severity, cfg->top_k);
+            }
+            else
+            {
+                dprintf(out_fd, "%s%s\n", PROTO_LOG, line);
+            }
+        }
+    }
+
+    free(buf);
+    close(fd);
+    return bugs;
+}
+
+// Runs in a forked child and leaves with _exit: the owner's stdio buffers
+// were copied by fork and must not be flushed twice.
+static void execute_worker(const LogAnalyzer *la, int file_idx, int chunk)
+{
+    const LogConfig *cfg = &la->cfg;
+    const LogFile *f = &la->files[file_idx];
+    int out_fd = f->pipe_fd[chunk][1];
+    close(f->pipe_fd[chunk][0]);
+
+    Aggregate *agg = cfg->aggregate ? &la->aggregates[f->agg_slot + chunk] : NULL;
+    regmatch_t m[3];
+    int local_bugs = 0;
+
+    IndexWriter *iw = NULL;
+    if (f->format == FORMAT_PLAIN)
+    {
+        IndexHeader h;
+        FILE *idx = index_open(f, &h);
+        if (idx)
+        {
+            local_bugs = scan_indexed(f, idx, &h, cfg, &la->regex, agg, out_fd);
+            fclose(idx);
+            goto report;
+        }
+        if (cfg->build_index)
+        {
+            iw = malloc(sizeof(IndexWriter));
+            if (iw && index_writer_open(iw, f) != 0)
+            {
+                free(iw);
+                iw = NULL;
+            }
+        }
+    }
+
+    LogReader *r = malloc(sizeof(LogReader));
+    if (!r || reader_open(r, f, chunk) != 0)
+        _exit(1);
+
+    char line[MAX_LINE];
+    unsigned long long line_end;
+    int first_line = (chunk == 0);
+
+    // A chunk owns the lines ending inside its range, except the first one,
+    // plus the line that straddles its end. The previous chunk reads the
+    // skipped partial line to completion, so every line is seen exactly once.
+    if (chunk > 0)
+    {
+        while (reader_gets(r, line, sizeof(line), &line_end))
+        {
+            size_t len = strlen(line);
+            if (!(len > 0 && line[len - 1] == '\n'))
+                continue;
+            if (line_end > r->boundary)
+                goto done;
+            break;
+        }
+    }
+
+    while (reader_gets(r, line, sizeof(line), &line_end))
+    {
+        size_t len = strlen(line);
+        int past_end = line_end > r->boundary && len > 0 && line[len - 1] == '\n';
+        trim_newline(line);
+
+        if (first_line && strncmp(line, "...", 3) == 0)
+        {
+            first_line = 0;
+            continue;
+        }
+        first_line = 0;
+
+        if (regexec(&la->regex, line, agg ? 3 : 0, agg ? m : NULL, 0) == 0)
+        {
+            int sev = severity_index(line);
+            long long ts = line_timestamp(line, sev);
+            if (iw)
+                index_add_line(iw, line_end - len, len, sev, ts);
+
+            if (!in_time_range(ts, cfg))
+                ;
+            else if (agg)
+                aggregate_line(agg, line, m, cfg->target_severity, cfg->top_k);
+            else if (matches_severity(line, cfg->target_severity))
+                dprintf(out_fd, "%s%s\n", PROTO_LOG, line);
+        }
+        else
+        {
+            if (iw)
+                index_add_line(iw, line_end - len, len, -1, -1);
+            local_bugs++;
+        }
+
+        if (past_end)
+            break;
+    }
+
+done:
+    reader_close(r);
+    if (iw)
+        index_writer_close(iw, f);
+
+report:
+    dprintf(out_fd, "%s%d\n", PROTO_BUG, local_bugs);
+    close(out_fd);
+    _exit(0);
+}
+
+// Whether files[i] depends on one of files[from..count)
+static int waits_for_later(const LogFile *files, int i, int from, int count)
+{
+    if (!files[i].dependency[0])
+        return 0;
+    for (int j = from; j < count; j++)
+        if (j != i && same_log(files[i].dependency, files[j].filename))
+            return 1;
+    return 0;
+}
+
+// Places every file after the one it depends on, otherwise keeping directory
+// order. A cycle is broken at the first file still waiting.
+static void sort_files_by_dependency(LogAnalyzer *la)
+{
+    LogFile *files = la->files;
+    for (int placed = 0; placed < la->file_count; placed++)
+    {
+        int pick = placed;
+        for (int i = placed; i < la->file_count; i++)
+        {
+            if (!waits_for_later(files, i, placed, la->file_count))
+            {
+                pick = i;
+                break;
+            }
+        }
+        LogFile tmp = files[pick];
+        memmove(&files[placed + 1], &files[placed], (pick - placed) * sizeof(LogFile));
+        files[placed] = tmp;
+    }
+}
+
+void log_default_config(LogConfig *cfg)
+{
+    strcpy(cfg->target_severity, "ERROR");
+    cfg->aggregate = 0;
+    cfg->top_k = 10;
+    cfg->jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg->build_index = 0;
+    cfg->from_ts = cfg->to_ts = -1;
+}
+
+LogAnalyzer *log_analyzer_create(const LogConfig *cfg)
+{
+    if (cfg->top_k < 0 || cfg->top_k > MAX_TOP_K)
+    {
+        fprintf(stderr, "top_k must be between 0 and %d\n", MAX_TOP_K);
+        return NULL;
+    }
+
+    LogAnalyzer *la = calloc(1, sizeof(LogAnalyzer));
+    if (!la)
+        return NULL;
+    la->cfg = *cfg;
+    if (la->cfg.jobs < 1)
+        la->cfg.jobs = 1;
+    if (la->cfg.jobs > MAX_CHUNKS)
+        la->cfg.jobs = MAX_CHUNKS;
+
+    if (regcomp(&la->regex, LOG_PATTERN, REG_EXTENDED))
+    {
+        free(la);
+        return NULL;
+    }
+    return la;
+}
+
+void log_analyzer_destroy(LogAnalyzer *la)
+{
+    if (!la)
+        return;
+    regfree(&la->regex);
+    free(la->files);
+    free(la);
+}
+
+int log_analyzer_file_count(const LogAnalyzer *la)
+{
+    return la->file_count;
+}
+
+const char *log_analyzer_file_name(const LogAnalyzer *la, int i)
+{
+    return la->files[i].filename;
+}
+
+int log_analyzer_file_bugs(const LogAnalyzer *la, int i)
+{
+    return la->files[i].bug_count;
+}
+
+// Next free LogFile slot, growing the array as needed
+static LogFile *add_file(LogAnalyzer *la)
+{
+    if (la->file_count == la->file_capacity)
+    {
+        int capacity = la->file_capacity ? 2 * la->file_capacity : 16;
+        LogFile *grown = realloc(la->files, capacity * sizeof(LogFile));
+        if (!grown)
+            return NULL;
+        la->files = grown;
+        la->file_capacity = capacity;
+    }
+    LogFile *f = &la->files[la->file_count++];
+    memset(f, 0, sizeof(LogFile));
+    return f;
+}
+
+int log_analyzer_run(LogAnalyzer *la, const char *logs_dir, FILE *out)
+{
+    const LogConfig *cfg = &la->cfg;
+    la->file_count = 0;
+
+    DIR *d = opendir(logs_dir);
+    if (!d)
+        return -1;
+
+    struct dirent *dir;
+    while ((dir = readdir(d)))
+    {
+        if (dir->d_type == DT_REG && is_log_name(dir->d_name))
+        {
+            LogFile *f = add_file(la);
+            if (!f)
+                break;
+
+            strcpy(f->filename, dir->d_name);
+            snprintf(f->filepath, MAX_PATH, "%s/%s",
+                     logs_dir, f->filename);
+
+            f->format = detect_format(f->filepath);
+            plan_chunks(f, cfg->jobs);
+
+            LogReader *r = malloc(sizeof(LogReader));
+            if (!r || reader_open(r, f, 0) != 0)
+            {
+                free(r);
+                la->file_count--;   // unreadable or unsupported format, skip it
+                continue;
+            }
+
+            char line[MAX_LINE];
+            unsigned long long line_end;
+            if (reader_gets(r, line, sizeof(line), &line_end))
+            {
+                trim_newline(line);
+                if (strncmp(line, "...", 3) == 0)
+                {
+                    const char *name = line + 3;   // "...base.txt" or "... base.txt"
+                    while (*name == ' ' || *name == '\t')
+                        name++;
+                    snprintf(f->dependency, sizeof(f->dependency), "%.*s",
+                             (int)sizeof(f->dependency) - 1, name);
+                }
+            }
+            reader_close(r);
+            free(r);
+        }
+    }
+    closedir(d);
+
+    sort_files_by_dependency(la);
+
+    LogFile *files = la->files;
+    int slot_count = 0;
+    for (int i = 0; i < la->file_count; i++)
+    {
+        files[i].agg_slot = slot_count;
+        slot_count += files[i].chunk_count;
+    }
+
+    la->aggregates = NULL;
+    if (cfg->aggregate && slot_count > 0)
+    {
+        // Shared anonymous mapping: workers fill their slot, the parent
+        // merges after they exit. Untouched buckets never get faulted in.
+        la->aggregates = mmap(NULL, slot_count * sizeof(Aggregate),
+                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (la->aggregates == MAP_FAILED)
+            return -1;
+        for (int i = 0; i < slot_count; i++)
+            init_aggregate(&la->aggregates[i]);
+    }
+
+    fflush(out);
+    for (int i = 0; i < la->file_count; i++)
+    {
+        for (int c = 0; c < files[i].chunk_count; c++)
+        {
+            pipe(files[i].pipe_fd[c]);
+
+            pid_t pid = fork();
+            if (pid == 0)
+                execute_worker(la, i, c);
+            files[i].pid[c] = pid;
+            close(files[i].pipe_fd[c][1]);
+        }
+    }
+
+    // Drain the pipes in order while the workers run; waiting first would
+    // block any worker whose output exceeds the pipe buffer.
+    for (int i = 0; i < la->file_count; i++)
+    {
+        for (int c = 0; c < files[i].chunk_count; c++)
+        {
+            FILE *in = fdopen(files[i].pipe_fd[c][0], "r");
+            char line[MAX_LINE];
+
+            while (fgets(line, sizeof(line), in))
+            {
+                if (strncmp(line, PROTO_LOG, 4) == 0)
+                    fprintf(out, "%s\n", line + 4);
+                else if (strncmp(line, PROTO_BUG, 4) == 0)
+                    files[i].bug_count += atoi(line + 4);
+            }
+            fclose(in);
+        }
+    }
+
+    // Only our own workers: the caller may have children of its own
+    for (int i = 0; i < la->file_count; i++)
+        for (int c = 0; c < files[i].chunk_count; c++)
+            if (files[i].pid[c] > 0)
+                waitpid(files[i].pid[c], NULL, 0);
+
+    int rc = 0;
+    if (la->aggregates)
+    {
+        Aggregate *summary = malloc(sizeof(Aggregate));
+        if (summary)
+        {
+            init_aggregate(summary);
+            for (int i = 0; i < slot_count; i++)
+                merge_aggregate(summary, &la->aggregates[i], cfg->top_k);
+            write_summary(out, summary, cfg);
+            free(summary);
+        }
+        else
+        {
+            rc = -1;
+        }
+        munmap(la->aggregates, slot_count * sizeof(Aggregate));
+        la->aggregates = NULL;
+    }
+
+    for (int i = 0; i < la->file_count; i++)
+        fprintf(out, "%s: %d bugs\n",
+                files[i].filename, files[i].bug_count);
+
+    return rc;
+}
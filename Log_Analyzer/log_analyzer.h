@@ -0,0 +1,47 @@
+#ifndef LOG_ANALYZER_H
+#define LOG_ANALYZER_H
+
+#include <stdio.h>
+
+// Scans a directory of logs (plain, gzip or zstd) with one forked worker per
+// file or per independent compressed chunk, in dependency order, and writes
+// either the matching lines or a summary. An analyzer keeps no global state
+// and can run any number of times.
+
+#define MAX_PATH 1024
+#define NUM_SEVERITIES 3
+#define MAX_TOP_K 32
+
+typedef struct LogAnalyzer LogAnalyzer;
+
+typedef struct
+{
+    char target_severity[20];
+    int aggregate;   // summary mode: aggregate instead of dumping lines
+    int top_k;
+    int jobs;        // max workers per splittable compressed file
+    int build_index; // write a sidecar index for plain files that lack a valid one
+    long long from_ts;  // YYYYMMDDHHMMSS bounds, -1 when open
+    long long to_ts;
+} LogConfig;
+
+// ERROR lines, no summary, top 10, one job per CPU, no index, no time range
+void log_default_config(LogConfig *cfg);
+
+// "YYYY-MM-DD HH:MM:SS" as YYYYMMDDHHMMSS, -1 if malformed
+long long parse_timestamp(const char *ts);
+
+// NULL if the configuration is invalid
+LogAnalyzer *log_analyzer_create(const LogConfig *cfg);
+void log_analyzer_destroy(LogAnalyzer *la);
+
+// Analyze every log in logs_dir and write the report to out.
+// Returns 0, or -1 if the directory or a resource is unavailable.
+int log_analyzer_run(LogAnalyzer *la, const char *logs_dir, FILE *out);
+
+// Files of the last run, in processing order
+int log_analyzer_file_count(const LogAnalyzer *la);
+const char *log_analyzer_file_name(const LogAnalyzer *la, int i);
+int log_analyzer_file_bugs(const LogAnalyzer *la, int i);
+
+#endif
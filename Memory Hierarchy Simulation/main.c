@@ -1,240 +1,208 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define CACHE_L1_SIZE 32
-#define CACHE_L2_SIZE 256
-#define MAIN_MEMORY_SIZE 1024
-#define VIRTUAL_MEMORY_SIZE 4096
+#include "memory_hierarchy.h"
 
-typedef struct {
-    int data;
-    int address;
-    int valid;
-    int access_time;
-    unsigned long last_access_time; 
-} MemoryBlock;
-
-typedef struct {
-    MemoryBlock l1_cache[CACHE_L1_SIZE];
-    MemoryBlock l2_cache[CACHE_L2_SIZE];
-    MemoryBlock main_memory[MAIN_MEMORY_SIZE];
-    MemoryBlock virtual_memory[VIRTUAL_MEMORY_SIZE];
-
-    int l1_hits;
-    int l1_misses;
-    int l2_hits;
-    int l2_misses;
-    int page_faults;
-
-    unsigned long counter; 
-} MemoryHierarchy;
-
-// Initialize memory hierarchy
-void initializeMemory(MemoryHierarchy *mh) {
-    for (int i = 0; i < CACHE_L1_SIZE; i++) {
-        mh->l1_cache[i].valid = 0;
-        mh->l1_cache[i].access_time = 1;
-        mh->l1_cache[i].last_access_time = 0;
-        mh->l1_cache[i].address = -1;
-        mh->l1_cache[i].data = 0;
-    }
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-    for (int i = 0; i < CACHE_L2_SIZE; i++) {
-        mh->l2_cache[i].valid = 0;
-        mh->l2_cache[i].access_time = 10;
-        mh->l2_cache[i].last_access_time = 0;
-        mh->l2_cache[i].address = -1;
-        mh->l2_cache[i].data = 0;
-    }
+// -S takes a spec or @file with one spec per line ('#' comments)
+static int addSweepSpecs(const char *arg, char specs[][SPEC_LEN], int count) {
+    if (arg[0] != '@') return expandSpec(arg, specs, count);
 
-    for (int i = 0; i < MAIN_MEMORY_SIZE; i++) {
-        mh->main_memory[i].data = rand() % 1000;
-        mh->main_memory[i].address = i;
-        mh->main_memory[i].valid = 1; 
-        mh->main_memory[i].access_time = 100;
-        mh->main_memory[i].last_access_time = 0;
+    FILE *fp = fopen(arg + 1, "r");
+    if (!fp) {
+        perror(arg + 1);
+        return -1;
     }
-
-    for (int i = 0; i < VIRTUAL_MEMORY_SIZE; i++) {
-        mh->virtual_memory[i].data = rand() % 1000;
-        mh->virtual_memory[i].address = i;
-        mh->virtual_memory[i].valid = 1;
-        mh->virtual_memory[i].access_time = 1000;
-        mh->virtual_memory[i].last_access_time = 0;
+    char line[SPEC_LEN];
+    while (count >= 0 && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        count = expandSpec(line, specs, count);
     }
-
-    mh->l1_hits = mh->l1_misses = mh->l2_hits = mh->l2_misses = mh->page_faults = 0;
-    mh->counter = 0;
+    fclose(fp);
+    return count;
 }
 
-int getLRUVictim(MemoryBlock cache[], int size) {
-    for (int i = 0; i < size; i++) {
-        if (!cache[i].valid) return i;
-    }
-    // here if all the slots are valid we should pick smallest last_access_time
-    int victim = 0;
-    unsigned long min_time = cache[0].last_access_time;
-    for (int i = 1; i < size; i++) {
-        if (cache[i].last_access_time < min_time) {
-            min_time = cache[i].last_access_time;
-            victim = i;
+int main(int argc, char *argv[]) {
+    static char specs[MAX_SWEEP][SPEC_LEN];
+    HierarchyConfig cfg;
+    defaultConfig(&cfg);
+    const char *trace_path = NULL;
+    const char *csv_path = NULL;
+    int binary_trace = 0;
+    int sweep_count = 0;
+    double reuse_rate = 0;              // > 0: reuse-distance analysis instead of simulation
+    double sample_error = 0;            // > 0: sampled simulation with this target error
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long total_accesses = 1000;         // synthetic workload without a trace
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:p:w:nc:l:g:S:j:o:r:P:T:e:s:a:")) != -1) {
+        switch (opt) {
+            case 't': trace_path = optarg; binary_trace = 0; break;
+            case 'b': trace_path = optarg; binary_trace = 1; break;
+            case 'p':
+                if (parsePolicies(optarg, cfg.policies) == 0) break;
+                fprintf(stderr, "bad policy list '%s' (lru, plru, rrip)\n", optarg);
+                return 1;
+            case 'w':
+                if (strcmp(optarg, "back") == 0) cfg.write_back = 1;
+                else if (strcmp(optarg, "through") == 0) cfg.write_back = 0;
+                else {
+                    fprintf(stderr, "bad write policy '%s' (back, through)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n': cfg.write_allocate = 0; break;
+            case 'c': cfg.num_cores = atoi(optarg); break;
+            case 'l': cfg.line_size = atoi(optarg); break;
+            case 'g':
+                if (applyConfig(&cfg, optarg) != 0) return 1;
+                break;
+            case 'S':
+                sweep_count = addSweepSpecs(optarg, specs, sweep_count);
+                if (sweep_count >= 0) break;
+                fprintf(stderr, "bad sweep '%s' (key=a|b,... up to %d points)\n", optarg, MAX_SWEEP);
+                return 1;
+            case 'j': jobs = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+            case 'o': csv_path = optarg; break;
+            case 'e':
+                sample_error = atof(optarg);
+                if (sample_error > 0 && sample_error < 1) break;
+                fprintf(stderr, "target error must be in (0, 1), e.g. 0.02 for 2%%\n");
+                return 1;
+            case 'T':
+                if ((cfg.tlb_page_bits = parseTlb(optarg)) >= 0) break;
+                fprintf(stderr, "bad page size '%s' (off, 4k, 2m)\n", optarg);
+                return 1;
+            case 'P':
+                if ((cfg.prefetcher = parsePrefetcher(optarg)) >= 0) break;
+                fprintf(stderr, "bad prefetcher '%s' (none, next, stride, stream)\n", optarg);
+                return 1;
+            case 's': cfg.seed = strtoull(optarg, NULL, 0); break;
+            case 'a':
+                total_accesses = atol(optarg);
+                if (total_accesses > 0) break;
+                fprintf(stderr, "the workload needs at least one access\n");
+                return 1;
+            case 'r':
+                reuse_rate = atof(optarg);
+                if (reuse_rate > 0 && reuse_rate <= 1) break;
+                fprintf(stderr, "sampling rate must be in (0, 1]\n");
+                return 1;
+            default:
+                fprintf(stderr, "usage: %s [-t text_trace|-] [-b binary_trace] [-p l1,l2,mm]\n"
+                                "          [-w back|through] [-n (no-write-allocate)]\n"
+                                "          [-c cores] [-l line_size] [-g key=value,...]\n"
+                                "          [-S sweep_spec|@file]... [-j jobs] [-o results.csv]\n"
+                                "          [-r sampling_rate (reuse-distance analysis)]\n"
+                                "          [-P none|next|stride|stream] [-T off|4k|2m]\n"
+                                "          [-e target_error (sampled simulation)]\n"
+                                "          [-s seed] [-a accesses (without a trace)]\n",
+                        argv[0]);
+                return 1;
         }
     }
-    return victim;
-}
-
-// Memory access function which is LRU-based in this version
-int accessMemory(MemoryHierarchy *mh, int address, int data) {
-    int total_time = 0;
-    mh->counter++;
+    if (checkConfig(&cfg) != 0) return 1;
 
-    //  L1 probe
-    total_time += 1; 
-    int l1_hit = -1;
-    for (int i = 0; i < CACHE_L1_SIZE; i++) {
-        if (mh->l1_cache[i].valid && mh->l1_cache[i].address == address) {
-            l1_hit = i;
-            break;
+    if (sweep_count > 0) {
+        if (!trace_path) {
+            fprintf(stderr, "a sweep needs a trace (-t or -b)\n");
+            return 1;
         }
-    }
-
-    if (l1_hit != -1) {
-        mh->l1_hits++;
-        mh->l1_cache[l1_hit].last_access_time = mh->counter;
-        mh->l1_cache[l1_hit].data = data; 
-        return total_time;
-    }
-    mh->l1_misses++;
-
-    //L2 probe 
-    total_time += 10; 
-    int l2_hit = -1;
-    for (int i = 0; i < CACHE_L2_SIZE; i++) {
-        if (mh->l2_cache[i].valid && mh->l2_cache[i].address == address) {
-            l2_hit = i;
-            break;
+        TraceReader tr;
+        if (traceLoad(&tr, trace_path, binary_trace) != 0) return 1;
+        FILE *csv = csv_path ? fopen(csv_path, "w") : stdout;
+        if (!csv) {
+            perror(csv_path);
+            return 1;
         }
+        double start = nowSeconds();
+        int rc = runSweep(&cfg, specs, sweep_count, &tr, jobs, csv);
+        if (csv != stdout) fclose(csv);
+        if (rc == 0)
+            fprintf(stderr, "%d configurations x %zu accesses in %.2f s with %d workers\n",
+                    sweep_count, tr.count, nowSeconds() - start, jobs);
+        traceClose(&tr);
+        return rc == 0 ? 0 : 1;
     }
 
-    
-    int l1_target = getLRUVictim(mh->l1_cache, CACHE_L1_SIZE);
-
-    if (l2_hit != -1) {
-        mh->l2_hits++;
-        mh->l2_cache[l2_hit].last_access_time = mh->counter;
-
-        // bring into L1
-        mh->l1_cache[l1_target] = mh->l2_cache[l2_hit];
-        mh->l1_cache[l1_target].last_access_time = mh->counter;
-        mh->l1_cache[l1_target].access_time = 1;
-        mh->l1_cache[l1_target].valid = 1;
-        mh->l1_cache[l1_target].data = data; 
-        return total_time;
+    if (sample_error > 0) {
+        if (!trace_path) {
+            fprintf(stderr, "sampled simulation needs a trace (-t or -b)\n");
+            return 1;
+        }
+        TraceReader tr;
+        if (traceLoad(&tr, trace_path, binary_trace) != 0) return 1;
+        int rc = runSampled(&cfg, &tr, sample_error);
+        traceClose(&tr);
+        return rc == 0 ? 0 : 1;
     }
-    mh->l2_misses++;
 
-    //  Main memory probe 
-    total_time += 100;
-    int mm_index = -1;
-    for (int i = 0; i < MAIN_MEMORY_SIZE; i++) {
-        if (mh->main_memory[i].valid && mh->main_memory[i].address == address) {
-            mm_index = i;
-            break;
+    if (reuse_rate > 0) {
+        if (!trace_path) {
+            fprintf(stderr, "reuse-distance analysis needs a trace (-t or -b)\n");
+            return 1;
         }
+        TraceReader tr;
+        int rc = binary_trace ? traceOpenBinary(&tr, trace_path) : traceOpenText(&tr, trace_path);
+        if (rc != 0) return 1;
+        FILE *csv = csv_path ? fopen(csv_path, "w") : NULL;
+        if (csv_path && !csv) {
+            perror(csv_path);
+            traceClose(&tr);
+            return 1;
+        }
+        rc = runReuse(&cfg, &tr, reuse_rate, csv);
+        if (csv) fclose(csv);
+        traceClose(&tr);
+        return rc == 0 ? 0 : 1;
     }
 
-    int l2_target = getLRUVictim(mh->l2_cache, CACHE_L2_SIZE);
-
-    if (mm_index != -1) {
-        mh->main_memory[mm_index].last_access_time = mh->counter;
-
-        // bring to L2
-        mh->l2_cache[l2_target] = mh->main_memory[mm_index];
-        mh->l2_cache[l2_target].last_access_time = mh->counter;
-        mh->l2_cache[l2_target].access_time = 10;
-        mh->l2_cache[l2_target].valid = 1;
+    MemoryHierarchy *mh = createHierarchy(&cfg);
+    if (!mh) return 1;
 
-        // bring to L1
-        mh->l1_cache[l1_target] = mh->main_memory[mm_index];
-        mh->l1_cache[l1_target].last_access_time = mh->counter;
-        mh->l1_cache[l1_target].access_time = 1;
-        mh->l1_cache[l1_target].valid = 1;
-        mh->l1_cache[l1_target].data = data; 
-        return total_time;
+    if (trace_path) {
+        TraceReader tr;
+        int rc = binary_trace ? traceOpenBinary(&tr, trace_path) : traceOpenText(&tr, trace_path);
+        if (rc == 0) {
+            rc = runTrace(mh, &tr);
+            traceClose(&tr);
+        }
+        destroyHierarchy(mh);
+        return rc == 0 ? 0 : 1;
     }
 
-    //  Page fault
-    mh->page_faults++;
-    int vm_index = address % VIRTUAL_MEMORY_SIZE;
-    total_time += mh->virtual_memory[vm_index].access_time;
-
-    int mm_target = getLRUVictim(mh->main_memory, MAIN_MEMORY_SIZE);
-
-    // swapping the page into main memory
-    mh->main_memory[mm_target] = mh->virtual_memory[vm_index];
-    mh->main_memory[mm_target].address = address;
-    mh->main_memory[mm_target].last_access_time = mh->counter;
-    mh->main_memory[mm_target].access_time = 100;
-    mh->main_memory[mm_target].valid = 1;
-
-    // now bring into L2 and L1
-    mh->l2_cache[l2_target] = mh->main_memory[mm_target];
-    mh->l2_cache[l2_target].last_access_time = mh->counter;
-    mh->l2_cache[l2_target].access_time = 10;
-    mh->l2_cache[l2_target].valid = 1;
-
-    mh->l1_cache[l1_target] = mh->main_memory[mm_target];
-    mh->l1_cache[l1_target].last_access_time = mh->counter;
-    mh->l1_cache[l1_target].access_time = 1;
-    mh->l1_cache[l1_target].valid = 1;
-    mh->l1_cache[l1_target].data = data; 
-
-    return total_time;
-}
-
-void printMemoryStats(MemoryHierarchy *mh) {
-    printf("\nMemory Access Statistics:\n");
-    printf("L1 Cache Hits: %d\n", mh->l1_hits);
-    printf("L1 Cache Misses: %d\n", mh->l1_misses);
-    printf("L2 Cache Hits: %d\n", mh->l2_hits);
-    printf("L2 Cache Misses: %d\n", mh->l2_misses);
-    printf("Page Faults: %d\n", mh->page_faults);
-
-    int l1_total = mh->l1_hits + mh->l1_misses;
-    int l2_total = mh->l2_hits + mh->l2_misses;
-
-    float l1_hit_ratio = (l1_total == 0) ? 0.0f : (float)mh->l1_hits / l1_total;
-    float l2_hit_ratio = (l2_total == 0) ? 0.0f : (float)mh->l2_hits / l2_total;
-
-    printf("\nCache Performance:\n");
-    printf("L1 Hit Ratio: %.2f%%\n", l1_hit_ratio * 100.0f);
-    printf("L2 Hit Ratio: %.2f%%\n", l2_hit_ratio * 100.0f);
-}
-
-int main() {
-    MemoryHierarchy mh;
-    srand(time(NULL));
-    initializeMemory(&mh);
-
-    int total_accesses = 1000;
-    int total_time = 0;
+    unsigned long total_time = 0;
     int working_set = 256;
 
-    for (int i = 0; i < total_accesses; i++) {
-        int address;
-        if (rand() % 10 < 9) {
-            address = rand() % working_set;
-        } else {
-            address = rand() % VIRTUAL_MEMORY_SIZE;
-        }
-        int data = rand() % 1000;
-        total_time += accessMemory(&mh, address, data);
+    // generated a batch at a time, the same for a given seed on every run
+    static Workload workload;
+    static TraceRecord batch[TRACE_BATCH];
+    workloadInit(&workload, &cfg, working_set);
+    double start = nowSeconds();
+    for (long done = 0; done < total_accesses;) {
+        int n = total_accesses - done < TRACE_BATCH ? (int)(total_accesses - done) : TRACE_BATCH;
+        workloadBatch(&workload, batch, n);
+        total_time += accessBatch(mh, batch, n);
+        done += n;
     }
+    double seconds = nowSeconds() - start;
 
-    printMemoryStats(&mh);
-    printf("\nTotal Access Time: %d cycles\n", total_time);
+    printMemoryStats(mh);
+    printf("\nTotal Access Time: %lu cycles\n", total_time);
     printf("Average Access Time: %.2f cycles\n", (float)total_time / total_accesses);
+    printf("Simulation Time: %.3f s (%.2f M accesses/s, seed %llu)\n", seconds,
+           seconds > 0 ? total_accesses / seconds / 1e6 : 0.0, (unsigned long long)cfg.seed);
 
+    destroyHierarchy(mh);
     return 0;
 }
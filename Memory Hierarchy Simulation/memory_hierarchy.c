@@ -0,0 +1,2617 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#if !defined(MH_SCALAR) && defined(__x86_64__)
+#include <immintrin.h>
+#define MH_HAVE_X86_SIMD 1
+#endif
+
+#include "memory_hierarchy.h"
+
+// Default hierarchy, every value can be changed at runtime (-g, sweeps).
+// Cache geometry: sets, ways and line size must be powers of two
+#define LINE_SIZE 1                 // addresses per cache line
+#define L1_SETS 8
+#define L1_WAYS 4
+#define L2_SETS 64
+#define L2_WAYS 4
+
+#define PAGE_SIZE 1                 // addresses per main memory frame
+#define MAIN_MEMORY_SIZE 1024       // frames
+#define VIRTUAL_MEMORY_SIZE 4096    // pages
+
+// Latencies in cycles
+#define L1_TIME 1
+#define L2_TIME 10
+#define MEMORY_TIME 100
+#define DISK_TIME 1000              // page fault or page-out
+
+#define SEED 1
+
+// Multi-core: private L1/L2 per core kept coherent with MESI over a snooping
+// bus, main memory shared
+#define BUS_UPGRADE_TIME 20         // invalidate broadcast for a write to a shared line
+#define CACHE_TO_CACHE_TIME 40      // miss served by another core's copy
+#define HOTSPOT_LINES 10
+
+// Address translation (off by default): per-core dTLB and STLB, then a
+// 4-level x86-64 style walk with paging-structure caches. Page table entries
+// are 8 bytes, fetched through the core's L2 from their own address region.
+#define DTLB_SETS 16                // 64 entries for 4 KiB pages
+#define DTLB_WAYS 4
+#define DTLB_HUGE_SETS 8            // 32 entries for 2 MiB pages
+#define DTLB_HUGE_WAYS 4
+#define STLB_SETS 128               // 1024 entries, both page sizes
+#define STLB_WAYS 8
+#define STLB_TIME 7
+#define PWC_PML4_ENTRIES 2          // page-walk caches, fully associative
+#define PWC_PDPT_ENTRIES 4
+#define PWC_PD_ENTRIES 32
+#define PTE_REGION (1UL << 52)      // page tables live above any trace address
+
+// Sampled simulation (SMARTS): each period of the trace ends with a detailed
+// warm-up and a measured unit, the rest only keeps the caches warm
+#define SAMPLE_UNIT 1000            // accesses measured per unit
+#define SAMPLE_WARMUP 2000          // detailed accesses before each unit
+#define SAMPLE_FIRST_UNITS 100      // units of the first pass
+#define SAMPLE_PASSES 4
+#define CONFIDENCE_Z 1.96           // 95% two-sided
+
+// Reuse-distance analysis: lines are sampled by hash (SHARDS) at rate
+// threshold / SHARDS_MODULUS
+#define SHARDS_MODULUS (1UL << 24)
+#define REUSE_MIN_WINDOW (1UL << 16)  // Fenwick tree slots before the first compaction
+
+#define RRPV_MAX 3                  // 2-bit re-reference prediction values
+
+#define STRIDE_ENTRIES 64           // address-delta table, one entry per region
+#define STRIDE_REGION_BITS 12       // strides are tracked within 4 KiB of addresses
+#define STREAM_BUFFERS 4
+#define POLLUTION_FILTER 1024       // lines recently evicted by prefetches
+
+#define TRACE_WINDOW (64UL << 20)   // mapped bytes released after replay
+
+typedef struct {
+    int data;
+    unsigned long tag;              // line tag in the caches, page number in memory
+    int valid;
+    int dirty;                      // main memory: page must be written out on eviction
+    int access_time;
+    unsigned long last_access_time;
+} MemoryBlock;
+
+// Replacement state for one level, every operation is O(1) per access
+// (RRIP may age a set a few times before it finds a victim):
+//  - LRU:  intrusive doubly linked recency list per set, MRU at the head
+//  - PLRU: binary tree of direction bits per set, nodes 1..ways-1
+//  - RRIP: static RRIP with hit promotion, one prediction value per way
+// Invalid ways sit on a per-set free stack and are always used first.
+typedef struct {
+    int policy;
+    int ways;
+    int *prev;                      // LRU links, -2 while the way is free
+    int *next;
+    int *head;                      // per set
+    int *tail;
+    int *free_ways;                 // per set stack of invalid ways
+    int *free_count;
+    unsigned char *bits;            // PLRU tree nodes or RRIP values
+} Replacement;
+
+typedef struct {
+    int sets;
+    int ways;
+    int line_size;
+    int offset_bits;                // log2(line_size)
+    int index_bits;                 // log2(sets)
+} CacheGeometry;
+
+// A cache level in structure-of-arrays form. A probe only reads the valid
+// mask of one set and its tag row; replacement state and data are touched on
+// hits and fills. Arrays are set-major: set s owns ways [s * ways, (s + 1) * ways).
+// The masks also hold the MESI state of each line: invalid (no valid bit),
+// modified (dirty), shared (shared bit) or exclusive (neither).
+typedef struct {
+    CacheGeometry geom;
+    int access_time;
+    unsigned long *tags;            // 64-byte aligned for the SIMD compare
+    uint64_t *valid;                // one bit per way, one word per set (ways <= 64)
+    uint64_t *dirty;                // same layout, only used by write-back caches
+    uint64_t *shared;               // same layout, other cores may hold the line
+    uint64_t *words;                // per way: words of the line this core touched
+    uint64_t *prefetched;           // per set: brought in by a prefetch, not used yet
+    unsigned long *ready;           // per way: core cycle a prefetched line arrives
+    int *data;
+    Replacement repl;
+    unsigned long writebacks;       // dirty lines written to the next level
+} CacheLevel;
+
+typedef struct {
+    unsigned long region;           // address >> STRIDE_REGION_BITS
+    unsigned long last;             // last line missed on in the region
+    long stride;                    // in lines
+    int confidence;                 // times the stride repeated, prefetch from 2
+} StrideEntry;
+
+typedef struct {
+    unsigned long lines[MAX_PREFETCH_DEGREE];   // oldest first
+    unsigned long ready[MAX_PREFETCH_DEGREE];
+    int count;
+    unsigned long next;             // line the next refill fetches
+    unsigned long last_use;         // buffers are reallocated least recently used first
+} StreamBuffer;
+
+typedef struct {
+    int kind;
+    int degree;
+    int allocate_stream;            // the last miss went to memory past every buffer
+    StrideEntry strides[STRIDE_ENTRIES];
+    StreamBuffer streams[STREAM_BUFFERS];
+    unsigned long polluted[POLLUTION_FILTER];   // line + 1, direct mapped
+
+    unsigned long issued;
+    unsigned long useful;           // demand accesses served by a prefetched line
+    unsigned long timely;           // ... after it arrived
+    unsigned long late;             // ... while it was still in flight
+    unsigned long late_cycles;
+    unsigned long useless;          // evicted or dropped without a use
+    unsigned long pollution;        // demand misses on lines a prefetch evicted
+} Prefetcher;
+
+// TLBs are caches of page numbers, so they reuse CacheLevel with one-entry lines
+typedef struct {
+    CacheLevel dtlb;
+    CacheLevel stlb;                // tags carry the page size in bit 0
+    CacheLevel pwc[3];              // PML4, PDPT and PD entries, keyed by address prefix
+
+    unsigned long dtlb_hits;
+    unsigned long dtlb_misses;
+    unsigned long stlb_hits;
+    unsigned long stlb_misses;
+    unsigned long pwc_hits[3];
+    unsigned long walk_refs;        // page table entries read
+    unsigned long walk_l2_hits;
+    unsigned long walk_cycles;
+    unsigned long cycles;           // all translation cycles, STLB lookups included
+} Translation;
+
+// One core's private caches and what it observed
+typedef struct {
+    CacheLevel l1;
+    CacheLevel l2;
+    Prefetcher pf;
+    Translation tlb;
+    unsigned long cycle;            // sum of this core's access times
+
+    unsigned long l1_hits;
+    unsigned long l1_misses;
+    unsigned long l2_hits;
+    unsigned long l2_misses;
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long write_throughs;   // writes propagated below L1 by write-through
+    unsigned long upgrades;         // writes to shared lines that invalidated peers
+    unsigned long invalidations;    // copies lost to another core's write
+    unsigned long coherence_misses; // misses on a line lost to an invalidation
+    unsigned long false_sharing_misses;
+} Core;
+
+// Coherence counters of one line, created on its first invalidation
+typedef struct {
+    unsigned long line;             // address >> offset bits
+    unsigned long invalidations;
+    unsigned long false_sharing;    // the victim core never touched the written word
+    unsigned long coherence_misses;
+    uint64_t cores;                 // cores involved in its invalidations
+    uint64_t lost;                  // cores whose copy was invalidated, not yet missed on
+    uint64_t falsely_lost;
+    int used;
+} LineStats;
+
+// Open addressing, linear probing, grown at half load
+typedef struct {
+    LineStats *slots;
+    size_t capacity;
+    size_t count;
+} LineTable;
+
+// Returns the way holding tag in one set, or -1
+typedef int (*FindWayFn)(const unsigned long *tags, uint64_t valid, int ways, unsigned long tag);
+
+struct MemoryHierarchy {
+    HierarchyConfig cfg;
+    Core *cores;
+    MemoryBlock *main_memory;               // cfg.memory_frames
+    MemoryBlock *virtual_memory;            // cfg.virtual_pages
+    Replacement mm_repl;                    // main memory is one set of memory_frames ways
+
+    FindWayFn findWay;
+    const char *find_way_name;
+    int *page_table;                        // page number -> main memory frame, -1 when empty
+    int page_table_bits;                    // more than twice the frames
+
+    unsigned long page_faults;
+
+    unsigned long page_outs;        // dirty pages written to virtual memory
+    unsigned long writeback_cycles; // part of the total time spent writing data down
+
+    unsigned long cache_to_cache;   // private misses served by a peer's copy
+    LineTable lines;
+
+    unsigned long counter;
+};
+
+typedef struct {
+    unsigned long accesses;
+    unsigned long total_time;
+    unsigned long foreign;          // records of cores beyond the configured count
+    double seconds;
+} ReplayStats;
+
+// Single-pass LRU stack distances (Mattson). The Fenwick tree holds a 1 at
+// the time of the last access of every live line, so the distance of a reuse
+// is the number of ones after that line's previous access time. Times are
+// renumbered when the tree is full, which keeps it proportional to the lines.
+typedef struct {
+    double rate;                    // fraction of lines sampled, 1 = exact
+    unsigned long threshold;        // sampled when hash % SHARDS_MODULUS < threshold
+    unsigned long *keys;            // line -> last access time, open addressing
+    unsigned long *times;           // 0 marks an empty slot
+    size_t capacity;
+    size_t count;
+    unsigned long *tree;            // Fenwick tree over times 1..window
+    size_t window;
+    unsigned long clock;
+    unsigned long *histogram;       // sampled distance -> reuses
+    size_t histogram_size;
+    unsigned long cold;             // first touches
+    unsigned long sampled;
+    unsigned long accesses;
+} ReuseAnalyzer;
+
+// One sweep point, written by its worker into shared memory
+typedef struct {
+    int done;
+    ReplayStats replay;
+    HierarchyStats stats;
+} SweepResult;
+
+static int log2i(int x) {
+    int bits = 0;
+    while ((1 << bits) < x) bits++;
+    return bits;
+}
+
+static void initGeometry(CacheGeometry *g, int sets, int ways, int line_size) {
+    g->sets = sets;
+    g->ways = ways;
+    g->line_size = line_size;
+    g->offset_bits = log2i(line_size);
+    g->index_bits = log2i(sets);
+}
+
+// Split an address into the set it maps to and the tag stored in that set
+static inline int cacheSet(const CacheGeometry *g, unsigned long address) {
+    return (address >> g->offset_bits) & (g->sets - 1);
+}
+
+static inline unsigned long cacheTag(const CacheGeometry *g, unsigned long address) {
+    return address >> (g->offset_bits + g->index_bits);
+}
+
+// First address of the line held in (set, tag), used when writing a victim back
+static inline unsigned long lineAddress(const CacheGeometry *g, int set, unsigned long tag) {
+    return ((tag << g->index_bits) | (unsigned long)set) << g->offset_bits;
+}
+
+// Word of the line an address falls on, folded into the 64-bit touch masks
+static inline uint64_t wordBit(const CacheGeometry *g, unsigned long address) {
+    return 1ULL << ((address & (g->line_size - 1)) & 63);
+}
+
+static inline int vmIndex(const MemoryHierarchy *mh, unsigned long page) {
+    return (page * mh->cfg.page_size) % mh->cfg.virtual_pages;
+}
+
+//  Page table: open addressing with linear probing over frame indices
+static inline unsigned int pageHash(const MemoryHierarchy *mh, unsigned long page) {
+    return (unsigned int)((page * 0x9E3779B97F4A7C15UL) >> (64 - mh->page_table_bits));
+}
+
+static int pageTableLookup(MemoryHierarchy *mh, unsigned long page) {
+    unsigned int mask = (1u << mh->page_table_bits) - 1;
+    for (unsigned int i = pageHash(mh, page);; i = (i + 1) & mask) {
+        int frame = mh->page_table[i];
+        if (frame == -1) return -1;
+        if (mh->main_memory[frame].tag == page) return frame;
+    }
+}
+
+static void pageTableInsert(MemoryHierarchy *mh, unsigned long page, int frame) {
+    unsigned int mask = (1u << mh->page_table_bits) - 1;
+    unsigned int i = pageHash(mh, page);
+    while (mh->page_table[i] != -1)
+        i = (i + 1) & mask;
+    mh->page_table[i] = frame;
+}
+
+// Backward-shift deletion keeps every probe chain intact without tombstones
+static void pageTableRemove(MemoryHierarchy *mh, unsigned long page) {
+    unsigned int mask = (1u << mh->page_table_bits) - 1;
+    unsigned int i = pageHash(mh, page);
+    while (mh->page_table[i] != -1 && mh->main_memory[mh->page_table[i]].tag != page)
+        i = (i + 1) & mask;
+    if (mh->page_table[i] == -1) return;
+
+    unsigned int hole = i;
+    for (unsigned int j = (i + 1) & mask; mh->page_table[j] != -1; j = (j + 1) & mask) {
+        unsigned int home = pageHash(mh, mh->main_memory[mh->page_table[j]].tag);
+        // move j into the hole unless its home lies cyclically in (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            mh->page_table[hole] = mh->page_table[j];
+            hole = j;
+        }
+    }
+    mh->page_table[hole] = -1;
+}
+
+//  Replacement policies
+
+const char *POLICY_NAMES[] = {"lru", "plru", "rrip"};
+
+int parsePolicy(const char *name) {
+    for (int p = POLICY_LRU; p <= POLICY_RRIP; p++) {
+        if (strcmp(name, POLICY_NAMES[p]) == 0) return p;
+    }
+    return -1;
+}
+
+const char *PREFETCH_NAMES[] = {"none", "next", "stride", "stream"};
+
+int parsePrefetcher(const char *name) {
+    for (int p = PREFETCH_NONE; p <= PREFETCH_STREAM; p++) {
+        if (strcmp(name, PREFETCH_NAMES[p]) == 0) return p;
+    }
+    return -1;
+}
+
+static int initReplacement(Replacement *r, int policy, int sets, int ways) {
+    size_t n = (size_t)sets * ways;
+    r->policy = policy;
+    r->ways = ways;
+    r->prev = malloc(n * sizeof(int));
+    r->next = malloc(n * sizeof(int));
+    r->head = malloc(sets * sizeof(int));
+    r->tail = malloc(sets * sizeof(int));
+    r->free_ways = malloc(n * sizeof(int));
+    r->free_count = malloc(sets * sizeof(int));
+    r->bits = calloc(n, 1);
+    if (!r->prev || !r->next || !r->head || !r->tail || !r->free_ways || !r->free_count || !r->bits)
+        return -1;
+
+    for (int s = 0; s < sets; s++) {
+        r->head[s] = r->tail[s] = -1;
+        r->free_count[s] = ways;
+        // pushed in reverse so way 0 is handed out first
+        for (int w = 0; w < ways; w++) {
+            r->free_ways[(size_t)s * ways + w] = ways - 1 - w;
+            r->prev[(size_t)s * ways + w] = -2;
+        }
+    }
+    return 0;
+}
+
+static void freeReplacement(Replacement *r) {
+    free(r->prev);
+    free(r->next);
+    free(r->head);
+    free(r->tail);
+    free(r->free_ways);
+    free(r->free_count);
+    free(r->bits);
+}
+
+static inline void lruUnlink(Replacement *r, int set, int way) {
+    size_t base = (size_t)set * r->ways;
+    int p = r->prev[base + way], n = r->next[base + way];
+    if (p >= 0) r->next[base + p] = n; else r->head[set] = n;
+    if (n >= 0) r->prev[base + n] = p; else r->tail[set] = p;
+}
+
+static inline void lruPushHead(Replacement *r, int set, int way) {
+    size_t base = (size_t)set * r->ways;
+    int h = r->head[set];
+    r->prev[base + way] = -1;
+    r->next[base + way] = h;
+    if (h >= 0) r->prev[base + h] = way; else r->tail[set] = way;
+    r->head[set] = way;
+}
+
+// Point every tree node on the way's path away from it
+static inline void plruTouch(Replacement *r, int set, int way) {
+    unsigned char *tree = &r->bits[(size_t)set * r->ways];
+    int node = 1;
+    for (int bit = r->ways >> 1; bit > 0; bit >>= 1) {
+        int right = (way & bit) != 0;
+        tree[node] = !right;
+        node = 2 * node + right;
+    }
+}
+
+// Hit on a resident way
+static inline void replTouch(Replacement *r, int set, int way) {
+    switch (r->policy) {
+        case POLICY_LRU:
+            if (r->head[set] != way) {
+                lruUnlink(r, set, way);
+                lruPushHead(r, set, way);
+            }
+            break;
+        case POLICY_PLRU: plruTouch(r, set, way); break;
+        case POLICY_RRIP: r->bits[(size_t)set * r->ways + way] = 0; break;
+    }
+}
+
+// Way to fill next: a free way if the set has one, else the policy's victim
+static inline int replVictim(Replacement *r, int set) {
+    size_t base = (size_t)set * r->ways;
+    if (r->free_count[set] > 0) return r->free_ways[base + r->free_count[set] - 1];
+
+    switch (r->policy) {
+        case POLICY_LRU:
+            return r->tail[set];
+        case POLICY_PLRU: {
+            int node = 1;
+            while (node < r->ways) node = 2 * node + r->bits[base + node];
+            return node - r->ways;
+        }
+        default: {
+            unsigned char *rrpv = &r->bits[base];
+            for (;;) {
+                for (int w = 0; w < r->ways; w++) {
+                    if (rrpv[w] == RRPV_MAX) return w;
+                }
+                for (int w = 0; w < r->ways; w++) rrpv[w]++;
+            }
+        }
+    }
+}
+
+// A new block was placed in way (normally the one replVictim returned)
+static inline void replInsert(Replacement *r, int set, int way) {
+    size_t base = (size_t)set * r->ways;
+    if (r->prev[base + way] == -2) {
+        int *stack = &r->free_ways[base];
+        int top = --r->free_count[set];
+        for (int i = top; stack[i] != way; i--) {   // normally the top already
+            int tmp = stack[i - 1];
+            stack[i - 1] = stack[i];
+            stack[i] = tmp;
+        }
+        r->prev[base + way] = -1;
+        if (r->policy == POLICY_LRU) {
+            lruPushHead(r, set, way);
+            return;
+        }
+    }
+
+    switch (r->policy) {
+        case POLICY_LRU: replTouch(r, set, way); break;
+        case POLICY_PLRU: plruTouch(r, set, way); break;
+        case POLICY_RRIP: r->bits[base + way] = RRPV_MAX - 1; break;
+    }
+}
+
+// Way was invalidated, hand it out again before evicting anything
+static inline void replInvalidate(Replacement *r, int set, int way) {
+    size_t base = (size_t)set * r->ways;
+    if (r->prev[base + way] == -2) return;
+    if (r->policy == POLICY_LRU) lruUnlink(r, set, way);
+    r->prev[base + way] = -2;
+    r->free_ways[base + r->free_count[set]++] = way;
+}
+
+//  Tag compare: scalar fallback plus SSE4.1 / AVX2 / AVX-512 variants
+
+static int findWayScalar(const unsigned long *tags, uint64_t valid, int ways, unsigned long tag) {
+    for (int i = 0; i < ways; i++) {
+        if (((valid >> i) & 1) && tags[i] == tag) return i;
+    }
+    return -1;
+}
+
+#ifdef MH_HAVE_X86_SIMD
+// Tags are 64-bit, so one compare covers 2 (SSE), 4 (AVX2) or 8 (AVX-512) ways.
+// Sets narrower than the vector fall back to the scalar loop.
+__attribute__((target("sse4.1")))
+static int findWaySSE(const unsigned long *tags, uint64_t valid, int ways, unsigned long tag) {
+    if (ways < 2) return findWayScalar(tags, valid, ways, tag);
+    __m128i needle = _mm_set1_epi64x((long long)tag);
+    for (int i = 0; i < ways; i += 2) {
+        __m128i eq = _mm_cmpeq_epi64(_mm_load_si128((const __m128i *)(tags + i)), needle);
+        uint64_t hits = (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq)) & (valid >> i);
+        if (hits) return i + __builtin_ctzll(hits);
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static int findWayAVX2(const unsigned long *tags, uint64_t valid, int ways, unsigned long tag) {
+    if (ways < 4) return findWayScalar(tags, valid, ways, tag);
+    __m256i needle = _mm256_set1_epi64x((long long)tag);
+    for (int i = 0; i < ways; i += 4) {
+        __m256i eq = _mm256_cmpeq_epi64(_mm256_load_si256((const __m256i *)(tags + i)), needle);
+        uint64_t hits = (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) & (valid >> i);
+        if (hits) return i + __builtin_ctzll(hits);
+    }
+    return -1;
+}
+
+__attribute__((target("avx512f")))
+static int findWayAVX512(const unsigned long *tags, uint64_t valid, int ways, unsigned long tag) {
+    if (ways < 8) return findWayAVX2(tags, valid, ways, tag);
+    __m512i needle = _mm512_set1_epi64((long long)tag);
+    for (int i = 0; i < ways; i += 8) {
+        uint64_t hits = _mm512_cmpeq_epu64_mask(_mm512_load_si512(tags + i), needle) & (valid >> i);
+        if (hits) return i + __builtin_ctzll(hits);
+    }
+    return -1;
+}
+#endif
+
+// Best variant the CPU supports; MH_SIMD=scalar|sse4.1|avx2|avx512 caps it.
+// Building with -DMH_SCALAR removes the vector code entirely.
+static void selectFindWay(MemoryHierarchy *mh) {
+    mh->findWay = findWayScalar;
+    mh->find_way_name = "scalar";
+#ifdef MH_HAVE_X86_SIMD
+    const char *want = getenv("MH_SIMD");
+    int cap = 3;
+    if (want) {
+        if (strcmp(want, "scalar") == 0) cap = -1;
+        else if (strcmp(want, "sse4.1") == 0) cap = 0;
+        else if (strcmp(want, "avx2") == 0) cap = 1;
+        else if (strcmp(want, "avx512") == 0) cap = 2;
+    }
+    __builtin_cpu_init();
+    if (cap >= 0 && __builtin_cpu_supports("sse4.1")) {
+        mh->findWay = findWaySSE;
+        mh->find_way_name = "sse4.1";
+    }
+    if (cap >= 1 && __builtin_cpu_supports("avx2")) {
+        mh->findWay = findWayAVX2;
+        mh->find_way_name = "avx2";
+    }
+    if (cap >= 2 && __builtin_cpu_supports("avx512f")) {
+        mh->findWay = findWayAVX512;
+        mh->find_way_name = "avx512";
+    }
+#endif
+}
+
+static void *alignedArray(size_t count, size_t size) {
+    size_t bytes = (count * size + 63) & ~(size_t)63;
+    void *p = aligned_alloc(64, bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+// -1 when out of memory; freeCacheLevel releases whatever was allocated
+static int initCacheLevel(CacheLevel *c, int sets, int ways, int line_size, int access_time,
+                          int policy) {
+    initGeometry(&c->geom, sets, ways, line_size);
+    c->access_time = access_time;
+    // ways are a power of two, so a set wide enough for a vector compare
+    // always starts on a vector boundary
+    c->tags = alignedArray((size_t)sets * ways, sizeof(unsigned long));
+    c->valid = alignedArray(sets, sizeof(uint64_t));
+    c->dirty = alignedArray(sets, sizeof(uint64_t));
+    c->shared = alignedArray(sets, sizeof(uint64_t));
+    c->words = alignedArray((size_t)sets * ways, sizeof(uint64_t));
+    c->prefetched = alignedArray(sets, sizeof(uint64_t));
+    c->ready = alignedArray((size_t)sets * ways, sizeof(unsigned long));
+    c->writebacks = 0;
+    c->data = alignedArray((size_t)sets * ways, sizeof(int));
+    if (!c->tags || !c->valid || !c->dirty || !c->shared || !c->words || !c->prefetched ||
+        !c->ready || !c->data)
+        return -1;
+    return initReplacement(&c->repl, policy, sets, ways);
+}
+
+static void freeCacheLevel(CacheLevel *c) {
+    free(c->tags);
+    free(c->valid);
+    free(c->dirty);
+    free(c->shared);
+    free(c->words);
+    free(c->prefetched);
+    free(c->ready);
+    free(c->data);
+    freeReplacement(&c->repl);
+}
+
+void defaultConfig(HierarchyConfig *cfg) {
+    cfg->l1_sets = L1_SETS;
+    cfg->l1_ways = L1_WAYS;
+    cfg->l2_sets = L2_SETS;
+    cfg->l2_ways = L2_WAYS;
+    cfg->line_size = LINE_SIZE;
+    cfg->memory_frames = MAIN_MEMORY_SIZE;
+    cfg->page_size = PAGE_SIZE;
+    cfg->virtual_pages = VIRTUAL_MEMORY_SIZE;
+    cfg->l1_time = L1_TIME;
+    cfg->l2_time = L2_TIME;
+    cfg->memory_time = MEMORY_TIME;
+    cfg->disk_time = DISK_TIME;
+    cfg->upgrade_time = BUS_UPGRADE_TIME;
+    cfg->transfer_time = CACHE_TO_CACHE_TIME;
+    cfg->policies[0] = cfg->policies[1] = cfg->policies[2] = POLICY_LRU;
+    cfg->write_back = 1;
+    cfg->write_allocate = 1;
+    cfg->num_cores = 1;
+    cfg->prefetcher = PREFETCH_NONE;
+    cfg->prefetch_degree = PREFETCH_DEGREE;
+    cfg->tlb_page_bits = 0;
+    cfg->seed = SEED;
+}
+
+static int initTranslation(Translation *t, int page_bits) {
+    memset(t, 0, sizeof(*t));
+    int dtlb = page_bits == 21
+                   ? initCacheLevel(&t->dtlb, DTLB_HUGE_SETS, DTLB_HUGE_WAYS, 1, 0, POLICY_LRU)
+                   : initCacheLevel(&t->dtlb, DTLB_SETS, DTLB_WAYS, 1, 0, POLICY_LRU);
+    if (dtlb != 0 || initCacheLevel(&t->stlb, STLB_SETS, STLB_WAYS, 1, STLB_TIME, POLICY_LRU) != 0 ||
+        initCacheLevel(&t->pwc[0], 1, PWC_PML4_ENTRIES, 1, 0, POLICY_LRU) != 0 ||
+        initCacheLevel(&t->pwc[1], 1, PWC_PDPT_ENTRIES, 1, 0, POLICY_LRU) != 0 ||
+        initCacheLevel(&t->pwc[2], 1, PWC_PD_ENTRIES, 1, 0, POLICY_LRU) != 0)
+        return -1;
+    return 0;
+}
+
+static void freeTranslation(Translation *t) {
+    freeCacheLevel(&t->dtlb);
+    freeCacheLevel(&t->stlb);
+    for (int l = 0; l < 3; l++) freeCacheLevel(&t->pwc[l]);
+}
+
+//  Random numbers
+
+void rngSeed(Rng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);   // splitmix64
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+void rngJump(Rng *rng) {
+    static const uint64_t jump[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ULL << b))
+                for (int k = 0; k < 4; k++) s[k] ^= rng->s[k];
+            rngNext(rng);
+        }
+    }
+    memcpy(rng->s, s, sizeof(s));
+}
+
+// Stream 0 of the seed fills memory, core c's workload is stream c + 1
+void workloadInit(Workload *w, const HierarchyConfig *cfg, unsigned long working_set) {
+    Rng rng;
+    rngSeed(&rng, cfg->seed);
+    for (int c = 0; c < cfg->num_cores; c++) {
+        rngJump(&rng);
+        w->streams[c] = rng;
+    }
+    w->cores = cfg->num_cores;
+    w->next_core = 0;
+    w->working_set = working_set;
+    w->space = (unsigned long)cfg->virtual_pages * cfg->page_size;
+}
+
+void workloadBatch(Workload *w, TraceRecord *records, int n) {
+    for (int i = 0; i < n; i++) {
+        int core = w->next_core;
+        Rng *rng = &w->streams[core];
+        int hot = rngBelow(rng, 10) < 9;
+        records[i].address = rngBelow(rng, hot ? w->working_set : w->space);
+        records[i].is_write = rngBelow(rng, 10) < 3;
+        records[i].core = core;
+        w->next_core = core + 1 < w->cores ? core + 1 : 0;
+    }
+}
+
+// Initialize memory hierarchy from a validated, zeroed one; -1 when out of
+// memory, freeMemory releases whatever was allocated
+static int initializeMemory(MemoryHierarchy *mh, const HierarchyConfig *cfg) {
+    mh->cfg = *cfg;
+    mh->cores = calloc(cfg->num_cores, sizeof(Core));
+    if (!mh->cores) return -1;
+    for (int i = 0; i < cfg->num_cores; i++) {
+        if (initCacheLevel(&mh->cores[i].l1, cfg->l1_sets, cfg->l1_ways, cfg->line_size,
+                           cfg->l1_time, cfg->policies[0]) != 0 ||
+            initCacheLevel(&mh->cores[i].l2, cfg->l2_sets, cfg->l2_ways, cfg->line_size,
+                           cfg->l2_time, cfg->policies[1]) != 0)
+            return -1;
+        mh->cores[i].pf.kind = cfg->prefetcher;
+        mh->cores[i].pf.degree = cfg->prefetch_degree;
+        if (cfg->tlb_page_bits && initTranslation(&mh->cores[i].tlb, cfg->tlb_page_bits) != 0)
+            return -1;
+    }
+    if (initReplacement(&mh->mm_repl, cfg->policies[2], 1, cfg->memory_frames) != 0) return -1;
+    selectFindWay(mh);
+
+    mh->page_table_bits = log2i(cfg->memory_frames) + 1;
+    if ((1 << mh->page_table_bits) <= cfg->memory_frames) mh->page_table_bits++;
+    mh->page_table = calloc((size_t)1 << mh->page_table_bits, sizeof(int));
+    mh->main_memory = calloc(cfg->memory_frames, sizeof(MemoryBlock));
+    mh->virtual_memory = calloc(cfg->virtual_pages, sizeof(MemoryBlock));
+    if (!mh->page_table || !mh->main_memory || !mh->virtual_memory) return -1;
+    for (int i = 0; i < 1 << mh->page_table_bits; i++)
+        mh->page_table[i] = -1;
+
+    Rng rng;
+    rngSeed(&rng, cfg->seed);
+    for (int i = 0; i < cfg->memory_frames; i++) {
+        mh->main_memory[i].data = (int)rngBelow(&rng, 1000);
+        mh->main_memory[i].tag = i;
+        mh->main_memory[i].valid = 1;
+        mh->main_memory[i].dirty = 0;
+        mh->main_memory[i].access_time = cfg->memory_time;
+        mh->main_memory[i].last_access_time = 0;
+        pageTableInsert(mh, i, i);
+        replInsert(&mh->mm_repl, 0, i);     // frame 0 ends up least recently used
+    }
+
+    for (int i = 0; i < cfg->virtual_pages; i++) {
+        mh->virtual_memory[i].data = (int)rngBelow(&rng, 1000);
+        mh->virtual_memory[i].tag = i;
+        mh->virtual_memory[i].valid = 1;
+        mh->virtual_memory[i].dirty = 0;
+        mh->virtual_memory[i].access_time = cfg->disk_time;
+        mh->virtual_memory[i].last_access_time = 0;
+    }
+
+    mh->page_faults = 0;
+    mh->page_outs = mh->writeback_cycles = mh->cache_to_cache = 0;
+    memset(&mh->lines, 0, sizeof(mh->lines));
+    mh->counter = 0;
+    return 0;
+}
+
+static void freeMemory(MemoryHierarchy *mh) {
+    for (int i = 0; mh->cores && i < mh->cfg.num_cores; i++) {
+        freeCacheLevel(&mh->cores[i].l1);
+        freeCacheLevel(&mh->cores[i].l2);
+        if (mh->cfg.tlb_page_bits) freeTranslation(&mh->cores[i].tlb);
+    }
+    free(mh->cores);
+    freeReplacement(&mh->mm_repl);
+    free(mh->page_table);
+    free(mh->main_memory);
+    free(mh->virtual_memory);
+    free(mh->lines.slots);
+}
+
+MemoryHierarchy *createHierarchy(const HierarchyConfig *cfg) {
+    if (checkConfig(cfg) != 0) return NULL;
+    MemoryHierarchy *mh = calloc(1, sizeof(MemoryHierarchy));
+    if (!mh || initializeMemory(mh, cfg) != 0) {
+        perror("createHierarchy");
+        destroyHierarchy(mh);
+        return NULL;
+    }
+    return mh;
+}
+
+void destroyHierarchy(MemoryHierarchy *mh) {
+    if (!mh) return;
+    freeMemory(mh);
+    free(mh);
+}
+
+//  Per-line coherence counters
+
+static size_t lineSlot(const LineTable *t, unsigned long line) {
+    return (size_t)((line * 0x9E3779B97F4A7C15ULL) >> 32) & (t->capacity - 1);
+}
+
+// -1 when out of memory, the table is left as it was
+static int lineTableGrow(LineTable *t) {
+    LineTable grown = {NULL, t->capacity ? t->capacity * 2 : 1024, 0};
+    grown.slots = calloc(grown.capacity, sizeof(LineStats));
+    if (!grown.slots) return -1;
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (!t->slots[i].used) continue;
+        size_t s = lineSlot(&grown, t->slots[i].line);
+        while (grown.slots[s].used) s = (s + 1) & (grown.capacity - 1);
+        grown.slots[s] = t->slots[i];
+        grown.count++;
+    }
+    free(t->slots);
+    *t = grown;
+    return 0;
+}
+
+// Find the counters of a line; with create, add them if missing. NULL also
+// when a new line finds the table full and it cannot grow.
+static LineStats *lineStats(LineTable *t, unsigned long line, int create) {
+    if (create && (t->count + 1) * 2 > t->capacity && lineTableGrow(t) != 0 &&
+        t->count + 1 >= t->capacity)
+        return NULL;
+    if (t->count == 0 && !create) return NULL;
+
+    for (size_t s = lineSlot(t, line);; s = (s + 1) & (t->capacity - 1)) {
+        LineStats *e = &t->slots[s];
+        if (e->used && e->line == line) return e;
+        if (!e->used) {
+            if (!create) return NULL;
+            e->used = 1;
+            e->line = line;
+            t->count++;
+            return e;
+        }
+    }
+}
+
+static inline void fillWay(CacheLevel *c, int set, int way, unsigned long tag, int data) {
+    size_t slot = (size_t)set * c->geom.ways + way;
+    c->tags[slot] = tag;
+    c->data[slot] = data;
+    c->words[slot] = 0;
+    c->valid[set] |= 1ULL << way;
+    c->dirty[set] &= ~(1ULL << way);
+    c->shared[set] &= ~(1ULL << way);
+    c->prefetched[set] &= ~(1ULL << way);
+    replInsert(&c->repl, set, way);
+}
+
+// Way holding the address in one cache level, or -1
+static inline int probeLevel(MemoryHierarchy *mh, CacheLevel *c, unsigned long address, int *set) {
+    *set = cacheSet(&c->geom, address);
+    return mh->findWay(&c->tags[(size_t)*set * c->geom.ways], c->valid[*set], c->geom.ways,
+                       cacheTag(&c->geom, address));
+}
+
+//  Write traffic. Every helper returns the cycles it costs.
+
+// Store into main memory, or straight into virtual memory if the page is out
+static int writeToMemory(MemoryHierarchy *mh, unsigned long address, int data) {
+    unsigned long page = address / mh->cfg.page_size;
+    int frame = pageTableLookup(mh, page);
+    if (frame != -1) {
+        mh->main_memory[frame].data = data;
+        mh->main_memory[frame].dirty = 1;
+        return mh->main_memory[frame].access_time;
+    }
+    mh->virtual_memory[vmIndex(mh, page)].data = data;
+    return mh->virtual_memory[vmIndex(mh, page)].access_time;
+}
+
+// Store into the core's L2 if it holds the line (dirty under write-back), else into memory
+static int writeToL2(MemoryHierarchy *mh, Core *core, unsigned long address, int data) {
+    CacheLevel *l2 = &core->l2;
+    int set;
+    int way = probeLevel(mh, l2, address, &set);
+    if (way == -1) return writeToMemory(mh, address, data);
+
+    l2->data[(size_t)set * l2->geom.ways + way] = data;
+    if (mh->cfg.write_back) {
+        l2->dirty[set] |= 1ULL << way;
+        return l2->access_time;
+    }
+    return l2->access_time + writeToMemory(mh, address, data);
+}
+
+// Make room in a cache way: a dirty victim is written to the level below,
+// clean and shared lines are dropped silently
+static int evictWay(MemoryHierarchy *mh, Core *core, CacheLevel *c, int set, int way) {
+    uint64_t bit = 1ULL << way;
+    if (c->prefetched[set] & bit) {
+        c->prefetched[set] &= ~bit;
+        core->pf.useless++;
+    }
+    if (!(c->valid[set] & c->dirty[set] & bit)) return 0;
+
+    size_t slot = (size_t)set * c->geom.ways + way;
+    unsigned long address = lineAddress(&c->geom, set, c->tags[slot]);
+    c->dirty[set] &= ~bit;
+    c->writebacks++;
+
+    int cycles = (c == &core->l1) ? writeToL2(mh, core, address, c->data[slot])
+                                  : writeToMemory(mh, address, c->data[slot]);
+    mh->writeback_cycles += cycles;
+    return cycles;
+}
+
+// Complete a write that hit (or was just allocated) in one cache level
+static int commitWrite(MemoryHierarchy *mh, Core *core, CacheLevel *c, int set, int way,
+                       unsigned long address, int data) {
+    c->data[(size_t)set * c->geom.ways + way] = data;
+    if (mh->cfg.write_back) {
+        c->dirty[set] |= 1ULL << way;
+        return 0;
+    }
+
+    core->write_throughs++;
+    int cycles = (c == &core->l1) ? writeToL2(mh, core, address, data)
+                                  : writeToMemory(mh, address, data);
+    mh->writeback_cycles += cycles;
+    return cycles;
+}
+
+//  MESI over a snooping bus
+
+// Another core's write took this core's copy. It is false sharing when the
+// core never touched the written word while it held the line.
+static void recordInvalidation(MemoryHierarchy *mh, int victim, int writer, unsigned long address,
+                               int false_sharing) {
+    unsigned long line = address >> mh->cores[victim].l1.geom.offset_bits;
+    LineStats *e = lineStats(&mh->lines, line, 1);
+    uint64_t bit = 1ULL << victim;
+
+    mh->cores[victim].invalidations++;
+    if (!e) return;     // out of memory: only the per-core count is kept
+    e->invalidations++;
+    e->cores |= bit | (1ULL << writer);
+    e->lost |= bit;
+    if (false_sharing) {
+        e->false_sharing++;
+        e->falsely_lost |= bit;
+    } else {
+        e->falsely_lost &= ~bit;
+    }
+}
+
+// A private miss: count it as a coherence miss if an invalidation caused it
+static void classifyMiss(MemoryHierarchy *mh, int self, unsigned long address) {
+    LineStats *e = lineStats(&mh->lines, address >> mh->cores[self].l1.geom.offset_bits, 0);
+    uint64_t bit = 1ULL << self;
+    if (!e || !(e->lost & bit)) return;
+
+    e->coherence_misses++;
+    mh->cores[self].coherence_misses++;
+    if (e->falsely_lost & bit) mh->cores[self].false_sharing_misses++;
+    e->lost &= ~bit;
+    e->falsely_lost &= ~bit;
+}
+
+// Broadcast a request for the line of address from core self. Modified peer
+// copies are flushed to memory first. An exclusive request (read for
+// ownership or upgrade) invalidates every peer copy, a read leaves them
+// shared. Returns the cycles spent flushing; *holders gets the number of
+// peers that had the line and *data their freshest copy.
+static int snoop(MemoryHierarchy *mh, int self, unsigned long address, int exclusive,
+                 int *holders, int *data) {
+    int cycles = 0;
+    *holders = 0;
+
+    for (int p = 0; p < mh->cfg.num_cores; p++) {
+        if (p == self) continue;
+        Core *peer = &mh->cores[p];
+        CacheLevel *levels[2] = {&peer->l1, &peer->l2};
+        int sets[2], ways[2];
+        uint64_t touched = 0;
+        int held = 0;
+
+        // L2 first, so an L1 copy modified after it reaches memory last
+        for (int l = 1; l >= 0; l--) {
+            CacheLevel *c = levels[l];
+            ways[l] = probeLevel(mh, c, address, &sets[l]);
+            if (ways[l] == -1) continue;
+
+            size_t slot = (size_t)sets[l] * c->geom.ways + ways[l];
+            uint64_t bit = 1ULL << ways[l];
+            held = 1;
+            touched |= c->words[slot];
+            *data = c->data[slot];
+            if (c->dirty[sets[l]] & bit) {
+                c->dirty[sets[l]] &= ~bit;
+                c->writebacks++;
+                int t = writeToMemory(mh, lineAddress(&c->geom, sets[l], c->tags[slot]),
+                                      c->data[slot]);
+                mh->writeback_cycles += t;
+                cycles += t;
+            }
+        }
+        if (!held) continue;
+        (*holders)++;
+
+        for (int l = 0; l < 2; l++) {
+            if (ways[l] == -1) continue;
+            CacheLevel *c = levels[l];
+            uint64_t bit = 1ULL << ways[l];
+            if (exclusive) {
+                c->valid[sets[l]] &= ~bit;
+                c->shared[sets[l]] &= ~bit;
+                c->prefetched[sets[l]] &= ~bit;
+                replInvalidate(&c->repl, sets[l], ways[l]);
+            } else {
+                c->shared[sets[l]] |= bit;
+            }
+        }
+        if (exclusive)
+            recordInvalidation(mh, p, self, address,
+                               !(touched & wordBit(&peer->l1.geom, address)));
+    }
+    return cycles;
+}
+
+// Write to a line this core holds shared: invalidate the peers, keep it exclusive
+static int upgradeLine(MemoryHierarchy *mh, int self, unsigned long address) {
+    Core *core = &mh->cores[self];
+    int holders, data;
+    core->upgrades++;
+    int cycles = mh->cfg.upgrade_time + snoop(mh, self, address, 1, &holders, &data);
+
+    CacheLevel *levels[2] = {&core->l1, &core->l2};
+    for (int l = 0; l < 2; l++) {
+        int set;
+        int way = probeLevel(mh, levels[l], address, &set);
+        if (way != -1) levels[l]->shared[set] &= ~(1ULL << way);
+    }
+    return cycles;
+}
+
+// Copy a block into main memory
+static void fillBlock(MemoryBlock *dst, const MemoryBlock *src, unsigned long tag,
+                      int access_time, unsigned long now) {
+    *dst = *src;
+    dst->tag = tag;
+    dst->last_access_time = now;
+    dst->access_time = access_time;
+    dst->valid = 1;
+}
+
+//  Address translation
+
+// Level 0 (PML4) .. 3 (PT): the address bits above this shift select the entry
+static inline int levelShift(int level) {
+    return 12 + 9 * (3 - level);
+}
+
+static void tlbFill(CacheLevel *c, unsigned long key) {
+    int set = cacheSet(&c->geom, key);
+    fillWay(c, set, replVictim(&c->repl, set), cacheTag(&c->geom, key), 0);
+}
+
+static int tlbProbe(MemoryHierarchy *mh, CacheLevel *c, unsigned long key) {
+    int set;
+    int way = probeLevel(mh, c, key, &set);
+    if (way != -1) replTouch(&c->repl, set, way);
+    return way != -1;
+}
+
+// Read one page table entry through the core's L2
+static int walkReference(MemoryHierarchy *mh, Core *core, unsigned long pte_address) {
+    CacheLevel *l2 = &core->l2;
+    int set;
+    int way = probeLevel(mh, l2, pte_address, &set);
+
+    core->tlb.walk_refs++;
+    if (way != -1) {
+        replTouch(&l2->repl, set, way);
+        core->tlb.walk_l2_hits++;
+        return l2->access_time;
+    }
+    int target = replVictim(&l2->repl, set);
+    int cycles = evictWay(mh, core, l2, set, target);
+    fillWay(l2, set, target, cacheTag(&l2->geom, pte_address), 0);
+    return cycles + l2->access_time + mh->cfg.memory_time;
+}
+
+// Walk from the deepest level a page-walk cache can vouch for down to the
+// leaf: the PT entry for 4 KiB pages, the PD entry for 2 MiB pages
+static int pageWalk(MemoryHierarchy *mh, Core *core, unsigned long address) {
+    Translation *t = &core->tlb;
+    int leaf = mh->cfg.tlb_page_bits == 21 ? 2 : 3;
+    int start = 0;
+
+    for (int l = leaf - 1; l >= 0; l--) {
+        if (tlbProbe(mh, &t->pwc[l], address >> levelShift(l))) {
+            t->pwc_hits[l]++;
+            start = l + 1;
+            break;
+        }
+    }
+
+    int cycles = 0;
+    for (int l = start; l <= leaf; l++) {
+        unsigned long entry = address >> levelShift(l);
+        cycles += walkReference(mh, core, PTE_REGION + ((unsigned long)l << 48) + entry * 8);
+        if (l < leaf) tlbFill(&t->pwc[l], entry);
+    }
+    t->walk_cycles += cycles;
+    return cycles;
+}
+
+// Cycles to translate an address. A dTLB hit overlaps the L1 probe and is free.
+static int translate(MemoryHierarchy *mh, Core *core, unsigned long address) {
+    Translation *t = &core->tlb;
+    unsigned long page = address >> mh->cfg.tlb_page_bits;
+
+    if (tlbProbe(mh, &t->dtlb, page)) {
+        t->dtlb_hits++;
+        return 0;
+    }
+    t->dtlb_misses++;
+
+    int cycles = t->stlb.access_time;
+    unsigned long key = (page << 1) | (mh->cfg.tlb_page_bits == 21);
+    if (tlbProbe(mh, &t->stlb, key)) {
+        t->stlb_hits++;
+    } else {
+        t->stlb_misses++;
+        cycles += pageWalk(mh, core, address);
+        tlbFill(&t->stlb, key);
+    }
+    tlbFill(&t->dtlb, page);
+    t->cycles += cycles;
+    return cycles;
+}
+
+//  Prefetchers
+
+// A prefetch may only read a resident page and a line no other core holds,
+// so it never faults and never needs a bus transaction
+static int prefetchable(MemoryHierarchy *mh, int self, unsigned long address, int *frame) {
+    *frame = pageTableLookup(mh, address / mh->cfg.page_size);
+    if (*frame == -1) return 0;
+    for (int p = 0; p < mh->cfg.num_cores; p++) {
+        int set;
+        if (p == self) continue;
+        if (probeLevel(mh, &mh->cores[p].l1, address, &set) != -1 ||
+            probeLevel(mh, &mh->cores[p].l2, address, &set) != -1)
+            return 0;
+    }
+    return 1;
+}
+
+static inline size_t pollutionSlot(unsigned long line) {
+    return (size_t)((line * 0x9E3779B97F4A7C15ULL) >> 32) % POLLUTION_FILTER;
+}
+
+// A demand miss on a line that a prefetch pushed out is pollution
+static void notePollution(Prefetcher *pf, unsigned long line) {
+    size_t s = pollutionSlot(line);
+    if (pf->polluted[s] == line + 1) {
+        pf->pollution++;
+        pf->polluted[s] = 0;
+    }
+}
+
+// Demand use of a prefetched L2 line; returns the cycles still waited for it
+static int prefetchUsed(Prefetcher *pf, unsigned long ready, unsigned long now) {
+    pf->useful++;
+    if (now >= ready) {
+        pf->timely++;
+        return 0;
+    }
+    pf->late++;
+    pf->late_cycles += ready - now;
+    return (int)(ready - now);
+}
+
+// Fetch one line from memory into L2 in the background
+static void prefetchLine(MemoryHierarchy *mh, int self, unsigned long line) {
+    Core *core = &mh->cores[self];
+    CacheLevel *l2 = &core->l2;
+    unsigned long address = line << l2->geom.offset_bits;
+    int set, frame;
+
+    if (probeLevel(mh, l2, address, &set) != -1 ||
+        probeLevel(mh, &core->l1, address, &frame) != -1)
+        return;
+    if (!prefetchable(mh, self, address, &frame)) return;
+
+    int way = replVictim(&l2->repl, set);
+    uint64_t bit = 1ULL << way;
+    size_t slot = (size_t)set * l2->geom.ways + way;
+    if ((l2->valid[set] & bit) && !(l2->prefetched[set] & bit)) {
+        unsigned long victim = lineAddress(&l2->geom, set, l2->tags[slot]) >> l2->geom.offset_bits;
+        core->pf.polluted[pollutionSlot(victim)] = victim + 1;
+    }
+    evictWay(mh, core, l2, set, way);
+    fillWay(l2, set, way, cacheTag(&l2->geom, address), mh->main_memory[frame].data);
+    l2->prefetched[set] |= bit;
+    l2->ready[slot] = core->cycle + mh->cfg.memory_time;
+    replTouch(&mh->mm_repl, 0, frame);
+    core->pf.issued++;
+}
+
+// Top a stream buffer up to its depth; a stream stops at a page that is out
+static void streamRefill(MemoryHierarchy *mh, int self, StreamBuffer *sb) {
+    Core *core = &mh->cores[self];
+    int shift = core->l1.geom.offset_bits;
+    while (sb->count < core->pf.degree) {
+        int frame;
+        if (!prefetchable(mh, self, sb->next << shift, &frame)) return;
+        replTouch(&mh->mm_repl, 0, frame);
+        sb->lines[sb->count] = sb->next++;
+        sb->ready[sb->count++] = core->cycle + mh->cfg.memory_time;
+        core->pf.issued++;
+    }
+}
+
+// Look for a line in the stream buffers. Entries ahead of it are skipped
+// (and wasted). Returns the cycles waited for the line, or -1 on a miss.
+static int streamLookup(MemoryHierarchy *mh, int self, unsigned long address, unsigned long now,
+                        int *frame) {
+    Prefetcher *pf = &mh->cores[self].pf;
+    unsigned long line = address >> mh->cores[self].l1.geom.offset_bits;
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        StreamBuffer *sb = &pf->streams[b];
+        for (int i = 0; i < sb->count; i++) {
+            if (sb->lines[i] != line) continue;
+
+            unsigned long ready = sb->ready[i];
+            pf->useless += i;
+            sb->count -= i + 1;
+            memmove(sb->lines, sb->lines + i + 1, sb->count * sizeof(unsigned long));
+            memmove(sb->ready, sb->ready + i + 1, sb->count * sizeof(unsigned long));
+            sb->last_use = mh->counter;
+
+            // the page may have been evicted since the line was fetched, and a
+            // line larger than a page spans pages that were never checked:
+            // the page of the accessed address itself has to be resident
+            *frame = pageTableLookup(mh, address / mh->cfg.page_size);
+            if (*frame == -1) {
+                pf->useless++;
+                return -1;
+            }
+            int stall = prefetchUsed(pf, ready, now);
+            streamRefill(mh, self, sb);
+            return stall;
+        }
+    }
+    return -1;
+}
+
+// Train on an L1 miss that has just been served
+static void prefetchTrain(MemoryHierarchy *mh, int self, unsigned long address) {
+    Prefetcher *pf = &mh->cores[self].pf;
+    unsigned long line = address >> mh->cores[self].l1.geom.offset_bits;
+
+    switch (pf->kind) {
+        case PREFETCH_NEXT:
+            for (int k = 1; k <= pf->degree; k++) prefetchLine(mh, self, line + k);
+            break;
+
+        case PREFETCH_STRIDE: {
+            unsigned long region = address >> STRIDE_REGION_BITS;
+            StrideEntry *e = &pf->strides[(region * 0x9E3779B97F4A7C15ULL >> 32) % STRIDE_ENTRIES];
+            if (e->region != region) {
+                e->region = region;
+                e->last = line;
+                e->stride = 0;
+                e->confidence = 0;
+                break;
+            }
+            long delta = (long)(line - e->last);
+            if (delta == 0) break;
+            if (delta == e->stride) {
+                if (e->confidence < 3) e->confidence++;
+            } else {
+                e->stride = delta;
+                e->confidence = 0;
+            }
+            e->last = line;
+            if (e->confidence >= 2)
+                for (int k = 1; k <= pf->degree; k++) prefetchLine(mh, self, line + k * e->stride);
+            break;
+        }
+
+        case PREFETCH_STREAM: {
+            if (!pf->allocate_stream) break;
+            pf->allocate_stream = 0;
+            StreamBuffer *sb = &pf->streams[0];
+            for (int b = 1; b < STREAM_BUFFERS; b++)
+                if (pf->streams[b].last_use < sb->last_use) sb = &pf->streams[b];
+            pf->useless += sb->count;
+            sb->count = 0;
+            sb->next = line + 1;
+            sb->last_use = mh->counter;
+            streamRefill(mh, self, sb);
+            break;
+        }
+    }
+}
+
+// Main memory frame of a page. On a page fault the page is swapped in over
+// the policy's victim, which is paged out first if dirty; the cycles for both
+// are added to *time.
+static int pageIn(MemoryHierarchy *mh, unsigned long page, int *time) {
+    int mm_index = pageTableLookup(mh, page);
+
+    if (mm_index != -1) {
+        mh->main_memory[mm_index].last_access_time = mh->counter;
+        replTouch(&mh->mm_repl, 0, mm_index);
+        return mm_index;
+    }
+
+    //  Page fault
+    mh->page_faults++;
+    int vm_index = vmIndex(mh, page);
+    *time += mh->virtual_memory[vm_index].access_time;
+
+    mm_index = replVictim(&mh->mm_repl, 0);
+    MemoryBlock *victim = &mh->main_memory[mm_index];
+    if (victim->valid) {
+        if (victim->dirty) {
+            // page-out before the frame can be reused
+            MemoryBlock *backing = &mh->virtual_memory[vmIndex(mh, victim->tag)];
+            backing->data = victim->data;
+            mh->page_outs++;
+            mh->writeback_cycles += backing->access_time;
+            *time += backing->access_time;
+        }
+        pageTableRemove(mh, victim->tag);
+    }
+
+    // swapping the page into main memory
+    fillBlock(victim, &mh->virtual_memory[vm_index], page, mh->cfg.memory_time, mh->counter);
+    victim->dirty = 0;
+    pageTableInsert(mh, page, mm_index);
+    replInsert(&mh->mm_repl, 0, mm_index);
+    return mm_index;
+}
+
+// Memory access function, replacement follows each level's policy.
+// Reads return the stored data through the hierarchy; writes follow the
+// write-back/write-through and write-allocate settings, and every cycle spent
+// writing dirty or written-through data down is added to the access time.
+// With several cores, a private miss is broadcast to the other cores first and
+// served from their copy when they have one; writes to shared lines
+// invalidate the other copies.
+static int demandAccess(MemoryHierarchy *mh, int core_id, unsigned long address, int data,
+                        int is_write) {
+    int total_time = 0;
+    Core *core = &mh->cores[core_id];
+    mh->counter++;
+    if (is_write) core->writes++;
+    else core->reads++;
+
+    // only the set the address maps to is searched
+    CacheLevel *l1 = &core->l1, *l2 = &core->l2;
+    int l1_set = cacheSet(&l1->geom, address);
+    int l2_set = cacheSet(&l2->geom, address);
+    size_t l1_base = (size_t)l1_set * l1->geom.ways;
+    size_t l2_base = (size_t)l2_set * l2->geom.ways;
+    unsigned long l1_tag = cacheTag(&l1->geom, address);
+    unsigned long l2_tag = cacheTag(&l2->geom, address);
+    uint64_t word = wordBit(&l1->geom, address);
+
+    //  L1 probe
+    total_time += l1->access_time;
+    int l1_way = mh->findWay(&l1->tags[l1_base], l1->valid[l1_set], l1->geom.ways, l1_tag);
+
+    if (l1_way != -1) {
+        core->l1_hits++;
+        replTouch(&l1->repl, l1_set, l1_way);
+        l1->words[l1_base + l1_way] |= word;
+        if (is_write) {
+            if (l1->shared[l1_set] & (1ULL << l1_way))
+                total_time += upgradeLine(mh, core_id, address);
+            total_time += commitWrite(mh, core, l1, l1_set, l1_way, address, data);
+        }
+        return total_time;
+    }
+    core->l1_misses++;
+
+    // write misses under no-write-allocate go around the caches
+    int allocate = !is_write || mh->cfg.write_allocate;
+
+    //L2 probe
+    total_time += l2->access_time;
+    int l2_way = mh->findWay(&l2->tags[l2_base], l2->valid[l2_set], l2->geom.ways, l2_tag);
+    int line_data;
+
+    if (l2_way != -1) {
+        core->l2_hits++;
+        replTouch(&l2->repl, l2_set, l2_way);
+        l2->words[l2_base + l2_way] |= word;
+        if (l2->prefetched[l2_set] & (1ULL << l2_way)) {
+            l2->prefetched[l2_set] &= ~(1ULL << l2_way);
+            total_time += prefetchUsed(&core->pf, l2->ready[l2_base + l2_way],
+                                       core->cycle + total_time);
+        }
+        if (!allocate) {
+            if (l2->shared[l2_set] & (1ULL << l2_way))
+                total_time += upgradeLine(mh, core_id, address);
+            return total_time + commitWrite(mh, core, l2, l2_set, l2_way, address, data);
+        }
+        line_data = l2->data[l2_base + l2_way];
+    } else {
+        //  Stream buffers are searched alongside L2
+        int stall = -1, frame = -1;
+        if (core->pf.kind == PREFETCH_STREAM && allocate)
+            stall = streamLookup(mh, core_id, address, core->cycle + total_time, &frame);
+        if (stall >= 0) {
+            int holders = 0;
+            total_time += stall;
+            if (mh->cfg.num_cores > 1)
+                total_time += snoop(mh, core_id, address, is_write, &holders, &line_data);
+            if (!holders) line_data = mh->main_memory[frame].data;
+
+            int target = replVictim(&l1->repl, l1_set);
+            total_time += evictWay(mh, core, l1, l1_set, target);
+            fillWay(l1, l1_set, target, l1_tag, line_data);
+            l1->words[l1_base + target] = word;
+            if (holders && !is_write) l1->shared[l1_set] |= 1ULL << target;
+            if (is_write) total_time += commitWrite(mh, core, l1, l1_set, target, address, data);
+            return total_time;
+        }
+
+        core->l2_misses++;
+        if (core->pf.kind != PREFETCH_NONE) {
+            notePollution(&core->pf, address >> l2->geom.offset_bits);
+            core->pf.allocate_stream = 1;
+        }
+
+        //  Other cores: read (shared) or read for ownership (exclusive)
+        int holders = 0;
+        if (mh->cfg.num_cores > 1) {
+            classifyMiss(mh, core_id, address);
+            total_time += snoop(mh, core_id, address, is_write, &holders, &line_data);
+        }
+
+        if (holders && allocate) {
+            mh->cache_to_cache++;
+            total_time += mh->cfg.transfer_time;
+        } else {
+            //  Main memory probe through the page table
+            total_time += mh->cfg.memory_time;
+            int mm_index = pageIn(mh, address / mh->cfg.page_size, &total_time);
+
+            if (!allocate) {
+                mh->main_memory[mm_index].data = data;
+                mh->main_memory[mm_index].dirty = 1;
+                return total_time;
+            }
+            line_data = mh->main_memory[mm_index].data;
+        }
+
+        // bring into L2, shared if another core kept a copy
+        int l2_target = replVictim(&l2->repl, l2_set);
+        total_time += evictWay(mh, core, l2, l2_set, l2_target);
+        fillWay(l2, l2_set, l2_target, l2_tag, line_data);
+        l2->words[l2_base + l2_target] = word;
+        if (holders && !is_write) l2->shared[l2_set] |= 1ULL << l2_target;
+        l2_way = l2_target;
+    }
+
+    // bring into L1 in the state the L2 copy has
+    int l1_target = replVictim(&l1->repl, l1_set);
+    total_time += evictWay(mh, core, l1, l1_set, l1_target);
+    fillWay(l1, l1_set, l1_target, l1_tag, line_data);
+    l1->words[l1_base + l1_target] = l2->words[l2_base + l2_way];
+    if (l2->shared[l2_set] & (1ULL << l2_way)) l1->shared[l1_set] |= 1ULL << l1_target;
+
+    if (is_write) {
+        if (l1->shared[l1_set] & (1ULL << l1_target))
+            total_time += upgradeLine(mh, core_id, address);
+        total_time += commitWrite(mh, core, l1, l1_set, l1_target, address, data);
+    }
+    return total_time;
+}
+
+// One access by one core, translated first when TLBs are modelled. Prefetchers
+// train on the L1 misses afterwards and their fills complete in the
+// background, relative to the core's own clock.
+int accessMemory(MemoryHierarchy *mh, int core_id, unsigned long address, int data,
+                 int is_write) {
+    Core *core = &mh->cores[core_id];
+    unsigned long l1_misses = core->l1_misses;
+    int total_time = mh->cfg.tlb_page_bits ? translate(mh, core, address) : 0;
+    total_time += demandAccess(mh, core_id, address, data, is_write);
+
+    core->cycle += total_time;
+    if (core->pf.kind != PREFETCH_NONE && core->l1_misses != l1_misses)
+        prefetchTrain(mh, core_id, address);
+    return total_time;
+}
+
+// A batch of trace records; the data written is the record's index
+unsigned long accessBatch(MemoryHierarchy *mh, const TraceRecord *records, int n) {
+    unsigned long total_time = 0;
+    for (int i = 0; i < n; i++) {
+        if (records[i].core >= mh->cfg.num_cores) continue;
+        total_time += accessMemory(mh, records[i].core, records[i].address, i,
+                                   records[i].is_write);
+    }
+    return total_time;
+}
+
+// Add up the counters of every core (only the writeback counts of the levels)
+static void sumCores(const MemoryHierarchy *mh, Core *total) {
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < mh->cfg.num_cores; i++) {
+        const Core *c = &mh->cores[i];
+        total->l1_hits += c->l1_hits;
+        total->l1_misses += c->l1_misses;
+        total->l2_hits += c->l2_hits;
+        total->l2_misses += c->l2_misses;
+        total->reads += c->reads;
+        total->writes += c->writes;
+        total->write_throughs += c->write_throughs;
+        total->upgrades += c->upgrades;
+        total->invalidations += c->invalidations;
+        total->coherence_misses += c->coherence_misses;
+        total->false_sharing_misses += c->false_sharing_misses;
+        total->l1.writebacks += c->l1.writebacks;
+        total->l2.writebacks += c->l2.writebacks;
+        total->pf.issued += c->pf.issued;
+        total->pf.useful += c->pf.useful;
+        total->pf.timely += c->pf.timely;
+        total->pf.late += c->pf.late;
+        total->pf.late_cycles += c->pf.late_cycles;
+        total->pf.useless += c->pf.useless;
+        total->pf.pollution += c->pf.pollution;
+        total->tlb.dtlb_hits += c->tlb.dtlb_hits;
+        total->tlb.dtlb_misses += c->tlb.dtlb_misses;
+        total->tlb.stlb_hits += c->tlb.stlb_hits;
+        total->tlb.stlb_misses += c->tlb.stlb_misses;
+        for (int l = 0; l < 3; l++) total->tlb.pwc_hits[l] += c->tlb.pwc_hits[l];
+        total->tlb.walk_refs += c->tlb.walk_refs;
+        total->tlb.walk_l2_hits += c->tlb.walk_l2_hits;
+        total->tlb.walk_cycles += c->tlb.walk_cycles;
+        total->tlb.cycles += c->tlb.cycles;
+    }
+}
+
+void getHierarchyStats(const MemoryHierarchy *mh, HierarchyStats *stats) {
+    Core total;
+    sumCores(mh, &total);
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < mh->cfg.num_cores; i++) stats->cycles += mh->cores[i].cycle;
+    stats->reads = total.reads;
+    stats->writes = total.writes;
+    stats->l1_hits = total.l1_hits;
+    stats->l1_misses = total.l1_misses;
+    stats->l2_hits = total.l2_hits;
+    stats->l2_misses = total.l2_misses;
+    stats->page_faults = mh->page_faults;
+    stats->writebacks = total.l1.writebacks + total.l2.writebacks + mh->page_outs;
+    stats->coherence_misses = total.coherence_misses;
+    stats->prefetches = total.pf.issued;
+    stats->useful_prefetches = total.pf.useful;
+    stats->dtlb_hits = total.tlb.dtlb_hits;
+    stats->dtlb_misses = total.tlb.dtlb_misses;
+    stats->stlb_misses = total.tlb.stlb_misses;
+    stats->walk_cycles = total.tlb.walk_cycles;
+}
+
+static void printTranslationStats(const MemoryHierarchy *mh, const Core *total) {
+    const Translation *t = &total->tlb;
+    const Translation *t0 = &mh->cores[0].tlb;
+    unsigned long accesses = t->dtlb_hits + t->dtlb_misses;
+    unsigned long stlb = t->stlb_hits + t->stlb_misses;
+
+    printf("\nAddress Translation (%s pages):\n", mh->cfg.tlb_page_bits == 21 ? "2 MiB" : "4 KiB");
+    printf("dTLB Hit Ratio: %.2f%% (%d entries)\n",
+           accesses ? 100.0 * t->dtlb_hits / accesses : 0.0, t0->dtlb.geom.sets * t0->dtlb.geom.ways);
+    printf("STLB Hit Ratio: %.2f%% (%d entries)\n", stlb ? 100.0 * t->stlb_hits / stlb : 0.0,
+           t0->stlb.geom.sets * t0->stlb.geom.ways);
+    printf("Page Walks: %lu (walk cache hits: PML4 %lu, PDPT %lu, PD %lu)\n", t->stlb_misses,
+           t->pwc_hits[0], t->pwc_hits[1], t->pwc_hits[2]);
+    printf("Walk Memory References: %lu (L2 hits %lu)\n", t->walk_refs, t->walk_l2_hits);
+    printf("Walk Cycles: %lu (%.2f per walk)\n", t->walk_cycles,
+           t->stlb_misses ? (double)t->walk_cycles / t->stlb_misses : 0.0);
+    printf("Translation Cycles: %lu (%.2f per access)\n", t->cycles,
+           accesses ? (double)t->cycles / accesses : 0.0);
+}
+
+// Accuracy: used / issued. Coverage: misses removed / misses without prefetch,
+// i.e. used / (used + remaining demand L2 misses).
+static void printPrefetchStats(const MemoryHierarchy *mh, const Core *total) {
+    const Prefetcher *pf = &total->pf;
+    printf("\nPrefetcher (%s, degree %d):\n", PREFETCH_NAMES[mh->cfg.prefetcher],
+           mh->cfg.prefetch_degree);
+    printf("Issued: %lu\n", pf->issued);
+    printf("Useful: %lu (timely %lu, late %lu, %lu cycles waited)\n", pf->useful, pf->timely,
+           pf->late, pf->late_cycles);
+    printf("Useless: %lu\n", pf->useless);
+    printf("Accuracy: %.2f%%\n", pf->issued ? 100.0 * pf->useful / pf->issued : 0.0);
+    printf("Coverage: %.2f%%\n", pf->useful + total->l2_misses
+                                     ? 100.0 * pf->useful / (pf->useful + total->l2_misses)
+                                     : 0.0);
+    printf("Pollution Misses: %lu\n", pf->pollution);
+}
+
+static int compareHotspots(const void *a, const void *b) {
+    const LineStats *x = a, *y = b;
+    if (x->invalidations != y->invalidations) return x->invalidations < y->invalidations ? 1 : -1;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static void printCoherenceStats(MemoryHierarchy *mh) {
+    Core total;
+    sumCores(mh, &total);
+
+    printf("\nCoherence (%d cores, MESI):\n", mh->cfg.num_cores);
+    printf("Bus Upgrades: %lu\n", total.upgrades);
+    printf("Invalidations: %lu\n", total.invalidations);
+    printf("Cache-to-Cache Transfers: %lu\n", mh->cache_to_cache);
+    printf("Coherence Misses: %lu (false sharing: %lu)\n", total.coherence_misses,
+           total.false_sharing_misses);
+
+    printf("\n%-4s %12s %8s %8s %12s %12s\n", "Core", "Accesses", "L1 Hit", "L2 Hit",
+           "Coh. Misses", "Invalidated");
+    for (int i = 0; i < mh->cfg.num_cores; i++) {
+        Core *c = &mh->cores[i];
+        unsigned long l1_total = c->l1_hits + c->l1_misses;
+        unsigned long l2_total = c->l2_hits + c->l2_misses;
+        printf("%-4d %12lu %7.2f%% %7.2f%% %12lu %12lu\n", i, c->reads + c->writes,
+               l1_total ? 100.0 * c->l1_hits / l1_total : 0.0,
+               l2_total ? 100.0 * c->l2_hits / l2_total : 0.0, c->coherence_misses,
+               c->invalidations);
+    }
+
+    if (mh->lines.count == 0) return;
+    LineStats *hot = malloc(mh->lines.count * sizeof(LineStats));
+    if (!hot) return;
+    size_t n = 0;
+    for (size_t i = 0; i < mh->lines.capacity; i++)
+        if (mh->lines.slots[i].used) hot[n++] = mh->lines.slots[i];
+    qsort(hot, n, sizeof(LineStats), compareHotspots);
+
+    printf("\nHotspot Lines (most invalidated of %zu):\n", n);
+    printf("%-18s %13s %13s %12s %6s\n", "Address", "Invalidations", "False Sharing",
+           "Coh. Misses", "Cores");
+    for (size_t i = 0; i < n && i < HOTSPOT_LINES; i++)
+        printf("0x%-16lx %13lu %13lu %12lu %6d\n", hot[i].line << mh->cores[0].l1.geom.offset_bits,
+               hot[i].invalidations, hot[i].false_sharing, hot[i].coherence_misses,
+               __builtin_popcountll(hot[i].cores));
+    free(hot);
+}
+
+void printMemoryStats(MemoryHierarchy *mh) {
+    Core total;
+    sumCores(mh, &total);
+
+    printf("\nMemory Access Statistics:\n");
+    printf("L1 Cache Hits: %lu\n", total.l1_hits);
+    printf("L1 Cache Misses: %lu\n", total.l1_misses);
+    printf("L2 Cache Hits: %lu\n", total.l2_hits);
+    printf("L2 Cache Misses: %lu\n", total.l2_misses);
+    printf("Page Faults: %lu\n", mh->page_faults);
+
+    printf("\nWrite Traffic (%s, %s):\n", mh->cfg.write_back ? "write-back" : "write-through",
+           mh->cfg.write_allocate ? "write-allocate" : "no-write-allocate");
+    printf("Reads / Writes: %lu / %lu\n", total.reads, total.writes);
+    printf("L1 Writebacks: %lu\n", total.l1.writebacks);
+    printf("L2 Writebacks: %lu\n", total.l2.writebacks);
+    printf("Main Memory Page-outs: %lu\n", mh->page_outs);
+    if (!mh->cfg.write_back) printf("Write-throughs: %lu\n", total.write_throughs);
+    printf("Writeback Cycles: %lu\n", mh->writeback_cycles);
+
+    unsigned long l1_total = total.l1_hits + total.l1_misses;
+    unsigned long l2_total = total.l2_hits + total.l2_misses;
+
+    float l1_hit_ratio = (l1_total == 0) ? 0.0f : (float)total.l1_hits / l1_total;
+    float l2_hit_ratio = (l2_total == 0) ? 0.0f : (float)total.l2_hits / l2_total;
+
+    printf("\nReplacement: L1 %s, L2 %s, main memory %s\n",
+           POLICY_NAMES[mh->cores[0].l1.repl.policy], POLICY_NAMES[mh->cores[0].l2.repl.policy],
+           POLICY_NAMES[mh->mm_repl.policy]);
+
+    printf("\nCache Performance:\n");
+    printf("L1 Hit Ratio: %.2f%%\n", l1_hit_ratio * 100.0f);
+    printf("L2 Hit Ratio: %.2f%%\n", l2_hit_ratio * 100.0f);
+
+    if (mh->cfg.prefetcher != PREFETCH_NONE) printPrefetchStats(mh, &total);
+    if (mh->cfg.tlb_page_bits) printTranslationStats(mh, &total);
+    if (mh->cfg.num_cores > 1) printCoherenceStats(mh);
+}
+
+//  Trace ingestion
+
+int traceOpenText(TraceReader *tr, const char *path) {
+    memset(tr, 0, sizeof(*tr));
+    tr->fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!tr->fp) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int traceOpenBinary(TraceReader *tr, const char *path) {
+    memset(tr, 0, sizeof(*tr));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    tr->count = st.st_size / sizeof(uint64_t);
+    if (tr->count > 0) {
+        tr->records = mmap(NULL, tr->count * sizeof(uint64_t), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (tr->records == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+        madvise((void *)tr->records, tr->count * sizeof(uint64_t), MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return 0;
+}
+
+// Fill up to max records; returns how many were read (0 at end of trace)
+int traceNextBatch(TraceReader *tr, TraceRecord batch[], int max) {
+    int n = 0;
+
+    if (tr->records) {
+        while (n < max && tr->pos < tr->count) {
+            uint64_t r = tr->records[tr->pos++];
+            batch[n].is_write = (r & TRACE_WRITE_BIT) != 0;
+            batch[n].core = (r >> TRACE_CORE_SHIFT) & TRACE_CORE_MASK;
+            batch[n].address = r & TRACE_ADDRESS_MASK;
+            n++;
+        }
+        // drop replayed pages so resident memory stays bounded on huge traces
+        size_t done_bytes = tr->pos * sizeof(uint64_t);
+        size_t released_bytes = tr->released * sizeof(uint64_t);
+        if (!tr->shared && !tr->owned && done_bytes - released_bytes >= TRACE_WINDOW) {
+            size_t upto = done_bytes & ~(TRACE_WINDOW - 1);
+            madvise((char *)tr->records + released_bytes, upto - released_bytes, MADV_DONTNEED);
+            tr->released = upto / sizeof(uint64_t);
+        }
+    } else {
+        char line[256];
+        while (n < max && fgets(line, sizeof(line), tr->fp)) {
+            tr->line_no++;
+            char *p = line;
+            while (*p == ' ' || *p == '\t') p++;
+            if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+            // optional leading core number for interleaved multi-core traces
+            char *end;
+            int core = 0;
+            if (*p >= '0' && *p <= '9') {
+                core = (int)strtol(p, &end, 10);
+                p = end;
+                while (*p == ' ' || *p == '\t') p++;
+            }
+
+            char op = *p++;
+            unsigned long address = strtoul(p, &end, 0);
+            if ((op != 'R' && op != 'W' && op != 'r' && op != 'w') || end == p) {
+                fprintf(stderr, "trace line %lu: expected \"[core] R|W <addr>\"\n", tr->line_no);
+                continue;
+            }
+            batch[n].is_write = (op == 'W' || op == 'w');
+            batch[n].core = core;
+            batch[n].address = address;
+            n++;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (batch[i].is_write) tr->writes++;
+        else tr->reads++;
+    }
+    return n;
+}
+
+void traceClose(TraceReader *tr) {
+    if (tr->owned) free((void *)tr->records);
+    else if (tr->records) munmap((void *)tr->records, tr->count * sizeof(uint64_t));
+    if (tr->fp && tr->fp != stdin) fclose(tr->fp);
+}
+
+// Bring a whole trace into memory as binary records for repeated replays.
+// Binary traces stay a read-only file mapping, text traces are encoded once.
+int traceLoad(TraceReader *tr, const char *path, int binary) {
+    if (binary) {
+        if (traceOpenBinary(tr, path) != 0) return -1;
+        tr->shared = 1;
+        return 0;
+    }
+    if (traceOpenText(tr, path) != 0) return -1;
+
+    TraceRecord *batch = calloc(TRACE_BATCH, sizeof(TraceRecord));
+    uint64_t *records = NULL;
+    size_t count = 0, capacity = 0;
+    int n = batch ? 1 : -1;
+    while (n > 0 && (n = traceNextBatch(tr, batch, TRACE_BATCH)) > 0) {
+        if (count + n > capacity) {
+            capacity = capacity ? capacity * 2 : 1 << 16;
+            uint64_t *grown = realloc(records, capacity * sizeof(uint64_t));
+            if (!grown) {
+                n = -1;
+                break;
+            }
+            records = grown;
+        }
+        for (int i = 0; i < n; i++)
+            records[count++] = (batch[i].is_write ? TRACE_WRITE_BIT : 0) |
+                               ((uint64_t)batch[i].core << TRACE_CORE_SHIFT) |
+                               (batch[i].address & TRACE_ADDRESS_MASK);
+    }
+    if (tr->fp != stdin) fclose(tr->fp);
+    free(batch);
+    if (n < 0) {
+        perror(path);
+        free(records);
+        memset(tr, 0, sizeof(*tr));
+        return -1;
+    }
+
+    memset(tr, 0, sizeof(*tr));
+    tr->records = records;
+    tr->count = count;
+    tr->owned = 1;
+    tr->shared = 1;
+    return 0;
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Replay a whole trace in batches, -1 when out of memory
+static int replayTrace(MemoryHierarchy *mh, TraceReader *tr, ReplayStats *rs) {
+    TraceRecord *batch = calloc(TRACE_BATCH, sizeof(TraceRecord));
+    int n;
+
+    memset(rs, 0, sizeof(*rs));
+    if (!batch) return -1;
+    double start = nowSeconds();
+    while ((n = traceNextBatch(tr, batch, TRACE_BATCH)) > 0) {
+        for (int i = 0; i < n; i++)
+            if (batch[i].core >= mh->cfg.num_cores) rs->foreign++;
+        rs->accesses += n;
+        rs->total_time += accessBatch(mh, batch, n);
+    }
+    rs->accesses -= rs->foreign;
+    rs->seconds = nowSeconds() - start;
+    free(batch);
+    return 0;
+}
+
+// Replay a trace and report the statistics and the simulator's throughput
+int runTrace(MemoryHierarchy *mh, TraceReader *tr) {
+    ReplayStats rs;
+    if (replayTrace(mh, tr, &rs) != 0) {
+        perror("runTrace");
+        return -1;
+    }
+
+    if (rs.foreign)
+        fprintf(stderr, "skipped %lu records of cores >= %d (see -c)\n", rs.foreign,
+                mh->cfg.num_cores);
+
+    printMemoryStats(mh);
+    printf("\nTrace: %lu accesses (%lu reads, %lu writes)\n", rs.accesses, tr->reads, tr->writes);
+    printf("Total Access Time: %lu cycles\n", rs.total_time);
+    printf("Average Access Time: %.2f cycles\n",
+           rs.accesses ? (double)rs.total_time / rs.accesses : 0.0);
+    printf("Simulation Time: %.3f s (%.2f M accesses/s, %s tag compare)\n", rs.seconds,
+           rs.seconds > 0 ? rs.accesses / rs.seconds / 1e6 : 0.0, mh->find_way_name);
+    return 0;
+}
+
+//  Sampled simulation
+
+// Why a configuration cannot be warmed functionally, or NULL when it can.
+// Its state depends on more than warmAccess keeps, so it warms through the
+// full access path instead.
+static const char *warmFallback(const HierarchyConfig *cfg) {
+    if (cfg->num_cores > 1) return "several cores";
+    if (cfg->prefetcher != PREFETCH_NONE) return "prefetcher";
+    if (cfg->tlb_page_bits) return "TLB";
+    if (!cfg->write_back) return "write-through";
+    if (!cfg->write_allocate) return "no-write-allocate";
+    return NULL;
+}
+
+// Functional warming: tags, replacement state, dirty bits and the page table
+// follow the trace without timing or statistics
+static void warmAccess(MemoryHierarchy *mh, int core_id, unsigned long address, int data,
+                       int is_write) {
+    const HierarchyConfig *cfg = &mh->cfg;
+    Core *core = &mh->cores[core_id];
+    CacheLevel *l1 = &core->l1, *l2 = &core->l2;
+    int l1_set, l2_set, unused = 0;
+    mh->counter++;
+
+    int way = probeLevel(mh, l1, address, &l1_set);
+    if (way == -1) {
+        int line_data;
+        int l2_way = probeLevel(mh, l2, address, &l2_set);
+        if (l2_way != -1) {
+            replTouch(&l2->repl, l2_set, l2_way);
+            line_data = l2->data[(size_t)l2_set * l2->geom.ways + l2_way];
+        } else {
+            int frame = pageIn(mh, address / cfg->page_size, &unused);
+            line_data = mh->main_memory[frame].data;
+            l2_way = replVictim(&l2->repl, l2_set);
+            evictWay(mh, core, l2, l2_set, l2_way);
+            fillWay(l2, l2_set, l2_way, cacheTag(&l2->geom, address), line_data);
+        }
+        way = replVictim(&l1->repl, l1_set);
+        evictWay(mh, core, l1, l1_set, way);
+        fillWay(l1, l1_set, way, cacheTag(&l1->geom, address), line_data);
+    } else {
+        replTouch(&l1->repl, l1_set, way);
+    }
+    if (is_write) {
+        l1->data[(size_t)l1_set * l1->geom.ways + way] = data;
+        l1->dirty[l1_set] |= 1ULL << way;
+    }
+}
+
+typedef struct {
+    double sum_x, sum_y, sum_xx, sum_yy, sum_xy;
+    int n;
+} RatioSample;
+
+static void ratioAdd(RatioSample *s, double x, double y) {
+    s->sum_x += x;
+    s->sum_y += y;
+    s->sum_xx += x * x;
+    s->sum_yy += y * y;
+    s->sum_xy += x * y;
+    s->n++;
+}
+
+// Ratio estimate sum(x) / sum(y) over the units and its confidence half-width
+static double ratioEstimate(const RatioSample *s, double *half_width) {
+    *half_width = 0;
+    if (s->sum_y <= 0) return 0.0;
+    double r = s->sum_x / s->sum_y;
+    if (s->n > 1) {
+        // variance of the residuals x - r * y
+        double ss = s->sum_xx - 2 * r * s->sum_xy + r * r * s->sum_yy;
+        double mean_y = s->sum_y / s->n;
+        *half_width = CONFIDENCE_Z * sqrt((ss > 0 ? ss : 0) / (s->n - 1)) / (mean_y * sqrt(s->n));
+    }
+    return r;
+}
+
+typedef struct {
+    RatioSample time;               // cycles per access
+    RatioSample l1;                 // L1 hits per access
+    RatioSample l2;                 // L2 hits per L2 lookup
+    size_t detailed;
+    size_t warmed;
+    double seconds;
+    double detailed_seconds;        // spent on detailed accesses, the rest is warming
+} SampledRun;
+
+// One pass over the trace with n units spread evenly over it, -1 when out of memory
+static int samplePass(const HierarchyConfig *cfg, const TraceReader *trace, int n, SampledRun *run) {
+    MemoryHierarchy *mh = createHierarchy(cfg);
+    TraceRecord *batch = calloc(TRACE_BATCH, sizeof(TraceRecord));
+    if (!mh || !batch) {
+        if (!batch) perror("samplePass");
+        free(batch);
+        destroyHierarchy(mh);
+        return -1;
+    }
+    TraceReader tr = *trace;
+    size_t total = tr.count, index = 0;
+    int unit = 0, got;
+    Core before, after;
+    unsigned long unit_time = 0;
+    int functional = warmFallback(cfg) == NULL;
+
+    memset(run, 0, sizeof(*run));
+    double start = nowSeconds(), detail_start = start;
+
+    // period j covers [total * j / n, total * (j + 1) / n) and ends with its unit
+    size_t period_end = total / n;
+    size_t measure_from = period_end > SAMPLE_UNIT ? period_end - SAMPLE_UNIT : 0;
+    size_t detail_from = measure_from > SAMPLE_WARMUP ? measure_from - SAMPLE_WARMUP : 0;
+
+    while ((got = traceNextBatch(&tr, batch, TRACE_BATCH)) > 0) {
+        for (int i = 0; i < got; i++, index++) {
+            TraceRecord *r = &batch[i];
+            if (index == detail_from) detail_start = nowSeconds();
+            if (index == measure_from) {
+                sumCores(mh, &before);
+                unit_time = 0;
+            }
+
+            // records of cores outside -c are skipped, but the unit
+            // boundaries are trace positions and advance over them too
+            if (r->core < cfg->num_cores && index < detail_from) {
+                if (functional) warmAccess(mh, r->core, r->address, (int)i, r->is_write);
+                else accessMemory(mh, r->core, r->address, (int)i, r->is_write);
+                run->warmed++;
+            } else if (r->core < cfg->num_cores) {
+                int t = accessMemory(mh, r->core, r->address, (int)i, r->is_write);
+                run->detailed++;
+                if (index >= measure_from) unit_time += t;
+            }
+
+            if (index + 1 == period_end) {
+                run->detailed_seconds += nowSeconds() - detail_start;
+                sumCores(mh, &after);
+                double accesses = (after.l1_hits + after.l1_misses) - (before.l1_hits + before.l1_misses);
+                // stream buffer hits are neither L2 hits nor misses, as in the full report
+                double l2_lookups = (after.l2_hits + after.l2_misses) - (before.l2_hits + before.l2_misses);
+                if (accesses > 0) {
+                    ratioAdd(&run->time, unit_time, accesses);
+                    ratioAdd(&run->l1, after.l1_hits - before.l1_hits, accesses);
+                    ratioAdd(&run->l2, after.l2_hits - before.l2_hits, l2_lookups);
+                }
+
+                unit++;
+                period_end = unit < n ? total * (unit + 1) / n : total + 1;
+                size_t period_start = total * unit / n;
+                measure_from = period_end - period_start > SAMPLE_UNIT ? period_end - SAMPLE_UNIT
+                                                                       : period_start;
+                detail_from = measure_from - period_start > SAMPLE_WARMUP
+                                  ? measure_from - SAMPLE_WARMUP
+                                  : period_start;
+            }
+        }
+    }
+    run->seconds = nowSeconds() - start;
+    free(batch);
+    destroyHierarchy(mh);
+    return 0;
+}
+
+// Repeat passes until the average access time is within the target relative
+// error; each new pass sizes its sample from the variance the last one saw
+int runSampled(const HierarchyConfig *cfg, const TraceReader *tr, double target) {
+    size_t max_units = tr->count / (SAMPLE_UNIT + SAMPLE_WARMUP);
+    if (max_units < 2) {
+        fprintf(stderr, "trace too short to sample (%zu accesses)\n", tr->count);
+        return -1;
+    }
+    int n = max_units < SAMPLE_FIRST_UNITS ? (int)max_units : SAMPLE_FIRST_UNITS;
+    SampledRun run;
+    double time, time_hw, l1, l1_hw, l2, l2_hw, seconds = 0, detailed_seconds = 0;
+    size_t detailed = 0, warmed = 0;
+    int pass = 0;
+
+    for (;;) {
+        if (samplePass(cfg, tr, n, &run) != 0) return -1;
+        seconds += run.seconds;
+        detailed_seconds += run.detailed_seconds;
+        detailed += run.detailed;
+        warmed += run.warmed;
+        pass++;
+        time = ratioEstimate(&run.time, &time_hw);
+        l1 = ratioEstimate(&run.l1, &l1_hw);
+        l2 = ratioEstimate(&run.l2, &l2_hw);
+
+        double error = time > 0 ? time_hw / time : 0.0;
+        if (error <= target || (size_t)n >= max_units || pass == SAMPLE_PASSES) break;
+        // the half-width shrinks with the square root of the units
+        double needed = n * (error / target) * (error / target) * 1.1;
+        n = needed >= max_units ? (int)max_units : (int)ceil(needed);
+    }
+
+    printf("\nSampled Simulation (SMARTS, 95%% confidence):\n");
+    printf("Units: %d x %d accesses, %d-access detailed warm-up each (%d pass%s)\n", n,
+           SAMPLE_UNIT, SAMPLE_WARMUP, pass, pass == 1 ? "" : "es");
+    const char *fallback = warmFallback(cfg);
+    size_t accepted = run.detailed + run.warmed;    // records of cores outside -c excluded
+    printf("Detailed: %.2f%% of %zu accesses, ", accepted ? 100.0 * run.detailed / accepted : 0.0,
+           accepted);
+    if (fallback) printf("full access path for the rest (no functional warming with %s)\n", fallback);
+    else printf("functional warming for the rest\n");
+    printf("\nCache Performance:\n");
+    printf("L1 Hit Ratio: %.2f%% ± %.2f%%\n", l1 * 100.0, l1_hw * 100.0);
+    printf("L2 Hit Ratio: %.2f%% ± %.2f%%\n", l2 * 100.0, l2_hw * 100.0);
+    printf("Average Access Time: %.2f ± %.2f cycles (±%.2f%%, target %.2f%%)\n", time, time_hw,
+           time > 0 ? 100.0 * time_hw / time : 0.0, target * 100.0);
+    if (time > 0 && time_hw / time > target)
+        printf("Target not reached: the trace has too few accesses for that many units\n");
+    printf("Simulation Time: %.3f s (%.2f M accesses/s)\n", seconds,
+           seconds > 0 ? (double)tr->count * pass / seconds / 1e6 : 0.0);
+
+    // a full run would pay the detailed cost on every access
+    double detailed_ns = detailed ? 1e9 * detailed_seconds / detailed : 0.0;
+    double warmed_ns = warmed ? 1e9 * (seconds - detailed_seconds) / warmed : 0.0;
+    printf("Cost per access: %.1f ns detailed, %.1f ns warmed\n", detailed_ns, warmed_ns);
+    printf("Speedup over a full run: %.2fx (estimated from the detailed cost)\n",
+           seconds > 0 ? accepted * detailed_ns / 1e9 / seconds : 0.0);
+    return 0;
+}
+
+//  Runtime configuration
+
+// "-p plru" sets every level, "-p lru,plru,rrip" (or lru/plru/rrip) sets L1, L2 and main memory
+int parsePolicies(const char *arg, int policies[3]) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    int n = 0;
+    for (char *tok = strtok(buf, ",/"); tok; tok = strtok(NULL, ",/")) {
+        if (n == 3 || (policies[n] = parsePolicy(tok)) < 0) return -1;
+        n++;
+    }
+    if (n == 1) policies[1] = policies[2] = policies[0];
+    return (n == 1 || n == 3) ? 0 : -1;
+}
+
+static int isPowerOfTwo(int x) {
+    return x >= 1 && (x & (x - 1)) == 0;
+}
+
+int checkConfig(const HierarchyConfig *cfg) {
+    const char *problem = NULL;
+    if (!isPowerOfTwo(cfg->l1_sets) || !isPowerOfTwo(cfg->l2_sets))
+        problem = "cache sets must be powers of two";
+    else if (!isPowerOfTwo(cfg->l1_ways) || !isPowerOfTwo(cfg->l2_ways) || cfg->l1_ways > 64 ||
+             cfg->l2_ways > 64)
+        problem = "cache ways must be powers of two up to 64";
+    else if (!isPowerOfTwo(cfg->line_size))
+        problem = "line size must be a power of two";
+    else if (cfg->memory_frames < 1 || cfg->memory_frames > (1 << 24) || cfg->page_size < 1 ||
+             cfg->virtual_pages < 1)
+        problem = "memory frames (1..16M), page size and virtual pages must be positive";
+    else if (cfg->num_cores < 1 || cfg->num_cores > MAX_CORES)
+        problem = "core count must be 1..64";
+    else if (cfg->prefetch_degree < 1 || cfg->prefetch_degree > MAX_PREFETCH_DEGREE)
+        problem = "prefetch degree must be 1..16";
+    else if (cfg->l1_time < 0 || cfg->l2_time < 0 || cfg->memory_time < 0 || cfg->disk_time < 0 ||
+             cfg->upgrade_time < 0 || cfg->transfer_time < 0)
+        problem = "latencies must not be negative";
+    if (problem) fprintf(stderr, "bad configuration: %s\n", problem);
+    return problem ? -1 : 0;
+}
+
+// Page size of the translation model: "off", "4k" or "2m", as address bits
+int parseTlb(const char *value) {
+    if (strcmp(value, "off") == 0) return 0;
+    if (strcmp(value, "4k") == 0) return 12;
+    if (strcmp(value, "2m") == 0) return 21;
+    return -1;
+}
+
+static int parseGeometry(const char *value, int *sets, int *ways) {
+    return sscanf(value, "%dx%d", sets, ways) == 2 ? 0 : -1;
+}
+
+// Apply "key=value,key=value" on top of cfg:
+//   l1=SETSxWAYS l2=SETSxWAYS line=N mem=FRAMES page=N vm=PAGES cores=N
+//   lat=L1/L2/MEM/DISK coh=UPGRADE/TRANSFER policy=P|P/P/P write=back|through alloc=yes|no
+//   prefetch=none|next|stride|stream degree=N tlb=off|4k|2m
+int applyConfig(HierarchyConfig *cfg, const char *spec) {
+    char buf[SPEC_LEN];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *save;
+    for (char *item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        int ok = value != NULL;
+        if (ok) {
+            *value++ = '\0';
+            if (strcmp(item, "l1") == 0) ok = parseGeometry(value, &cfg->l1_sets, &cfg->l1_ways) == 0;
+            else if (strcmp(item, "l2") == 0)
+                ok = parseGeometry(value, &cfg->l2_sets, &cfg->l2_ways) == 0;
+            else if (strcmp(item, "line") == 0) cfg->line_size = atoi(value);
+            else if (strcmp(item, "mem") == 0) cfg->memory_frames = atoi(value);
+            else if (strcmp(item, "page") == 0) cfg->page_size = atoi(value);
+            else if (strcmp(item, "vm") == 0) cfg->virtual_pages = atoi(value);
+            else if (strcmp(item, "cores") == 0) cfg->num_cores = atoi(value);
+            else if (strcmp(item, "lat") == 0)
+                ok = sscanf(value, "%d/%d/%d/%d", &cfg->l1_time, &cfg->l2_time,
+                            &cfg->memory_time, &cfg->disk_time) == 4;
+            else if (strcmp(item, "coh") == 0)
+                ok = sscanf(value, "%d/%d", &cfg->upgrade_time, &cfg->transfer_time) == 2;
+            else if (strcmp(item, "policy") == 0) ok = parsePolicies(value, cfg->policies) == 0;
+            else if (strcmp(item, "prefetch") == 0)
+                ok = (cfg->prefetcher = parsePrefetcher(value)) >= 0;
+            else if (strcmp(item, "degree") == 0) cfg->prefetch_degree = atoi(value);
+            else if (strcmp(item, "tlb") == 0) ok = (cfg->tlb_page_bits = parseTlb(value)) >= 0;
+            else if (strcmp(item, "seed") == 0) cfg->seed = strtoull(value, NULL, 0);
+            else if (strcmp(item, "write") == 0) {
+                cfg->write_back = strcmp(value, "back") == 0;
+                ok = cfg->write_back || strcmp(value, "through") == 0;
+            } else if (strcmp(item, "alloc") == 0) {
+                cfg->write_allocate = strcmp(value, "yes") == 0;
+                ok = cfg->write_allocate || strcmp(value, "no") == 0;
+            } else ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "bad configuration item '%s'\n", item);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//  Parameter sweeps
+
+// Expand "l1=8x4|16x4,lat=1/10/100/1000|1/12/80/1000" into every combination
+// of the '|' alternatives; returns the new count or -1 past MAX_SWEEP
+int expandSpec(const char *spec, char specs[][SPEC_LEN], int count) {
+    char buf[SPEC_LEN];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    // start from one empty combination and multiply it by every item
+    int first = count, n = 1;
+    specs[first][0] = '\0';
+    char *save;
+    for (char *item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        if (!value) return -1;
+        *value++ = '\0';
+
+        char alternatives[SPEC_LEN];
+        snprintf(alternatives, sizeof(alternatives), "%s", value);
+        char *alts[64];
+        int alt_count = 0;
+        char *alt_save;
+        for (char *a = strtok_r(alternatives, "|", &alt_save); a && alt_count < 64;
+             a = strtok_r(NULL, "|", &alt_save))
+            alts[alt_count++] = a;
+        if (alt_count == 0 || first + n * alt_count > MAX_SWEEP) return -1;
+
+        // alternative k of combination j goes to slot k * n + j
+        for (int k = alt_count - 1; k >= 0; k--) {
+            for (int j = 0; j < n; j++) {
+                char *dst = specs[first + k * n + j];
+                const char *prefix = specs[first + j];
+                char joined[SPEC_LEN];
+                snprintf(joined, sizeof(joined), "%s%s%s=%s", prefix, *prefix ? "," : "", item,
+                         alts[k]);
+                memcpy(dst, joined, SPEC_LEN);
+            }
+        }
+        n *= alt_count;
+    }
+    return first + n;
+}
+
+// Run one configuration in a worker and leave its counters in shared memory
+static void sweepPoint(const HierarchyConfig *cfg, const TraceReader *trace, SweepResult *out) {
+    MemoryHierarchy *mh = createHierarchy(cfg);
+    TraceReader tr = *trace;
+
+    // a point that runs out of memory is reported as not finished
+    if (mh && replayTrace(mh, &tr, &out->replay) == 0) {
+        getHierarchyStats(mh, &out->stats);
+        out->done = 1;
+    }
+    destroyHierarchy(mh);
+}
+
+// Simulate every spec over the same in-memory trace with up to jobs workers.
+// Workers are forked, so the trace buffer is shared read-only by all of them;
+// each one writes a single SweepResult slot of a shared mapping.
+int runSweep(const HierarchyConfig *base, char specs[][SPEC_LEN], int count,
+             const TraceReader *trace, int jobs, FILE *csv) {
+    HierarchyConfig *configs = calloc(count, sizeof(HierarchyConfig));
+    if (!configs) {
+        perror("runSweep");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        configs[i] = *base;
+        if (applyConfig(&configs[i], specs[i]) != 0 || checkConfig(&configs[i]) != 0) {
+            fprintf(stderr, "sweep point %d: %s\n", i + 1, specs[i]);
+            free(configs);
+            return -1;
+        }
+    }
+
+    SweepResult *results = mmap(NULL, count * sizeof(SweepResult), PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("mmap");
+        free(configs);
+        return -1;
+    }
+    memset(results, 0, count * sizeof(SweepResult));
+
+    pid_t *pids = calloc(jobs, sizeof(pid_t));
+    if (!pids) {
+        perror("runSweep");
+        munmap(results, count * sizeof(SweepResult));
+        free(configs);
+        return -1;
+    }
+    fflush(NULL);
+    int next = 0, running = 0;
+    while (next < count || running > 0) {
+        if (next < count && running < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                sweepPoint(&configs[next], trace, &results[next]);
+                _exit(0);
+            }
+            if (pid < 0) {
+                perror("fork");
+                if (running == 0) break;
+            } else {
+                pids[running++] = pid;
+                next++;
+                continue;
+            }
+        }
+        // only our own workers: the caller may have children of its own
+        while (waitpid(pids[0], NULL, 0) < 0 && errno == EINTR)
+            ;
+        memmove(pids, pids + 1, --running * sizeof(pid_t));
+    }
+    free(pids);
+
+    fprintf(csv, "config,l1_sets,l1_ways,l2_sets,l2_ways,line_size,memory_frames,page_size,"
+                 "cores,policy,write,prefetch,accesses,l1_hit_ratio,l2_hit_ratio,page_faults,"
+                 "writebacks,prefetch_accuracy,prefetch_coverage,tlb,dtlb_hit_ratio,page_walks,"
+                 "walk_cycles,"
+                 "coherence_misses,total_cycles,avg_access_time,seconds\n");
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        const HierarchyConfig *c = &configs[i];
+        const HierarchyStats *r = &results[i].stats;
+        const ReplayStats *rs = &results[i].replay;
+        if (!results[i].done) {
+            fprintf(stderr, "sweep point %d did not finish: %s\n", i + 1, specs[i]);
+            failed++;
+            continue;
+        }
+        unsigned long l1_total = r->l1_hits + r->l1_misses;
+        unsigned long l2_total = r->l2_hits + r->l2_misses;
+        unsigned long pf_base = r->useful_prefetches + r->l2_misses;
+        unsigned long translations = r->dtlb_hits + r->dtlb_misses;
+        fprintf(csv, "\"%s\",%d,%d,%d,%d,%d,%d,%d,%d,%s/%s/%s,%s%s,%s,%lu,%.4f,%.4f,%lu,%lu,%.4f,"
+                     "%.4f,%s,%.4f,%lu,%lu,%lu,%lu,%.2f,%.3f\n",
+                specs[i], c->l1_sets, c->l1_ways, c->l2_sets, c->l2_ways, c->line_size,
+                c->memory_frames, c->page_size, c->num_cores, POLICY_NAMES[c->policies[0]],
+                POLICY_NAMES[c->policies[1]], POLICY_NAMES[c->policies[2]],
+                c->write_back ? "back" : "through", c->write_allocate ? "" : "-noalloc",
+                PREFETCH_NAMES[c->prefetcher], rs->accesses,
+                l1_total ? (double)r->l1_hits / l1_total : 0.0,
+                l2_total ? (double)r->l2_hits / l2_total : 0.0, r->page_faults, r->writebacks,
+                r->prefetches ? (double)r->useful_prefetches / r->prefetches : 0.0,
+                pf_base ? (double)r->useful_prefetches / pf_base : 0.0,
+                c->tlb_page_bits == 21 ? "2m" : c->tlb_page_bits ? "4k" : "off",
+                translations ? (double)r->dtlb_hits / translations : 0.0, r->stlb_misses,
+                r->walk_cycles, r->coherence_misses, rs->total_time,
+                rs->accesses ? (double)rs->total_time / rs->accesses : 0.0, rs->seconds);
+    }
+
+    munmap(results, count * sizeof(SweepResult));
+    free(configs);
+    return failed ? -1 : 0;
+}
+
+//  Reuse-distance analysis
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// -1 when out of memory; freeReuse releases whatever was allocated
+static int initReuse(ReuseAnalyzer *ra, double rate) {
+    memset(ra, 0, sizeof(*ra));
+    ra->rate = rate;
+    ra->threshold = (unsigned long)(rate * SHARDS_MODULUS);
+    if (ra->threshold == 0) ra->threshold = 1;
+    ra->capacity = 1024;
+    ra->keys = calloc(ra->capacity, sizeof(unsigned long));
+    ra->times = calloc(ra->capacity, sizeof(unsigned long));
+    ra->window = REUSE_MIN_WINDOW;
+    ra->tree = calloc(ra->window + 1, sizeof(unsigned long));
+    ra->histogram_size = 1024;
+    ra->histogram = calloc(ra->histogram_size, sizeof(unsigned long));
+    return ra->keys && ra->times && ra->tree && ra->histogram ? 0 : -1;
+}
+
+static void freeReuse(ReuseAnalyzer *ra) {
+    free(ra->keys);
+    free(ra->times);
+    free(ra->tree);
+    free(ra->histogram);
+}
+
+static void fenwickAdd(ReuseAnalyzer *ra, size_t i, long delta) {
+    for (; i <= ra->window; i += i & -i) ra->tree[i] += delta;
+}
+
+static unsigned long fenwickSum(const ReuseAnalyzer *ra, size_t i) {
+    unsigned long sum = 0;
+    for (; i > 0; i -= i & -i) sum += ra->tree[i];
+    return sum;
+}
+
+// Slot of a line in the last-access table, empty if the line is new
+static size_t reuseSlot(const ReuseAnalyzer *ra, unsigned long line) {
+    size_t mask = ra->capacity - 1;
+    size_t s = mix64(line) & mask;
+    while (ra->times[s] && ra->keys[s] != line) s = (s + 1) & mask;
+    return s;
+}
+
+// -1 when out of memory, the table is left as it was
+static int reuseGrowTable(ReuseAnalyzer *ra) {
+    unsigned long *keys = ra->keys, *times = ra->times;
+    size_t old = ra->capacity;
+    unsigned long *grown_keys = calloc(2 * old, sizeof(unsigned long));
+    unsigned long *grown_times = calloc(2 * old, sizeof(unsigned long));
+    if (!grown_keys || !grown_times) {
+        free(grown_keys);
+        free(grown_times);
+        return -1;
+    }
+    ra->capacity = 2 * old;
+    ra->keys = grown_keys;
+    ra->times = grown_times;
+    for (size_t i = 0; i < old; i++) {
+        if (!times[i]) continue;
+        size_t s = reuseSlot(ra, keys[i]);
+        ra->keys[s] = keys[i];
+        ra->times[s] = times[i];
+    }
+    free(keys);
+    free(times);
+    return 0;
+}
+
+static int compareTimes(const void *a, const void *b) {
+    unsigned long x = **(unsigned long *const *)a, y = **(unsigned long *const *)b;
+    return (x > y) - (x < y);
+}
+
+// The tree ran out of times: renumber the live lines 1..count in access order.
+// -1 when out of memory.
+static int reuseCompact(ReuseAnalyzer *ra) {
+    unsigned long **live = calloc(ra->count ? ra->count : 1, sizeof(unsigned long *));
+    if (!live) return -1;
+    size_t n = 0;
+    for (size_t i = 0; i < ra->capacity; i++)
+        if (ra->times[i]) live[n++] = &ra->times[i];
+    qsort(live, n, sizeof(unsigned long *), compareTimes);
+    for (size_t i = 0; i < n; i++) *live[i] = i + 1;
+    free(live);
+
+    if (ra->window < 4 * n) {
+        unsigned long *tree = calloc(4 * n + 1, sizeof(unsigned long));
+        if (!tree) return -1;
+        free(ra->tree);
+        ra->tree = tree;
+        ra->window = 4 * n;
+    }
+    // linear construction of a tree whose first n counts are 1
+    memset(ra->tree, 0, (ra->window + 1) * sizeof(unsigned long));
+    for (size_t i = 1; i <= ra->window; i++) {
+        if (i <= n) ra->tree[i] += 1;
+        size_t parent = i + (i & -i);
+        if (parent <= ra->window) ra->tree[parent] += ra->tree[i];
+    }
+    ra->clock = n;
+    return 0;
+}
+
+// -1 when out of memory
+static int reuseAccess(ReuseAnalyzer *ra, unsigned long line) {
+    ra->accesses++;
+    if (ra->rate < 1.0 && mix64(line ^ 0x5DEECE66DULL) % SHARDS_MODULUS >= ra->threshold) return 0;
+    ra->sampled++;
+
+    if (ra->clock == ra->window && reuseCompact(ra) != 0) return -1;
+
+    unsigned long now = ++ra->clock;
+
+    size_t s = reuseSlot(ra, line);
+    if (ra->times[s]) {
+        unsigned long distance = fenwickSum(ra, now - 1) - fenwickSum(ra, ra->times[s]);
+        fenwickAdd(ra, ra->times[s], -1);
+        if (distance >= ra->histogram_size) {
+            size_t grown = ra->histogram_size;
+            while (grown <= distance) grown *= 2;
+            unsigned long *histogram = realloc(ra->histogram, grown * sizeof(unsigned long));
+            if (!histogram) return -1;
+            ra->histogram = histogram;
+            memset(ra->histogram + ra->histogram_size, 0,
+                   (grown - ra->histogram_size) * sizeof(unsigned long));
+            ra->histogram_size = grown;
+        }
+        ra->histogram[distance]++;
+    } else {
+        ra->cold++;
+        ra->keys[s] = line;
+        ra->count++;
+    }
+    ra->times[s] = now;
+    fenwickAdd(ra, now, 1);
+
+    if (ra->count * 2 > ra->capacity) return reuseGrowTable(ra);
+    return 0;
+}
+
+// Hit ratio of a fully associative LRU cache of the given lines. Sampled
+// distances are scaled by 1 / rate; the SHARDS adjustment credits the
+// difference between expected and sampled references to distance 0.
+static double reuseHitRatio(const ReuseAnalyzer *ra, double lines) {
+    double expected = ra->accesses * ra->rate;
+    double total = ra->rate < 1.0 ? expected : (double)ra->sampled;
+    if (total <= 0) return 0.0;
+
+    double hits = ra->rate < 1.0 ? expected - ra->sampled : 0.0;
+    for (size_t d = 0; d < ra->histogram_size && d / ra->rate < lines; d++)
+        hits += ra->histogram[d];
+    double ratio = hits / total;
+    return ratio < 0 ? 0.0 : ratio > 1 ? 1.0 : ratio;
+}
+
+// Miss-ratio curve at every power of two up to the largest reuse distance, plus
+// the L1 and L2 capacities of cfg with the ratios printMemoryStats would show
+// for fully associative LRU caches
+static void printReuse(const ReuseAnalyzer *ra, const HierarchyConfig *cfg, FILE *csv) {
+    size_t longest = 0;
+    for (size_t d = 0; d < ra->histogram_size; d++)
+        if (ra->histogram[d]) longest = d;
+    double max_lines = (longest + 1) / ra->rate;
+
+    printf("\nReuse Distance Analysis (fully associative LRU, line size %d):\n", cfg->line_size);
+    printf("Accesses: %lu\n", ra->accesses);
+    if (ra->rate < 1.0)
+        printf("Sampled: %lu (SHARDS rate %.4f)\n", ra->sampled, ra->rate);
+    printf("Distinct Lines: %.0f\n", ra->cold / ra->rate);
+
+    printf("\n%16s %10s %10s\n", "Capacity (lines)", "Hit Ratio", "Miss Ratio");
+    if (csv) fprintf(csv, "capacity_lines,hit_ratio,miss_ratio\n");
+    for (double lines = 1; ; lines *= 2) {
+        double hit = reuseHitRatio(ra, lines);
+        printf("%16.0f %9.2f%% %9.2f%%\n", lines, hit * 100.0, (1.0 - hit) * 100.0);
+        if (csv) fprintf(csv, "%.0f,%.6f,%.6f\n", lines, hit, 1.0 - hit);
+        if (lines >= max_lines) break;
+    }
+
+    double l1_lines = (double)cfg->l1_sets * cfg->l1_ways;
+    double l2_lines = (double)cfg->l2_sets * cfg->l2_ways;
+    double l1_hit = reuseHitRatio(ra, l1_lines);
+    double l2_reach = reuseHitRatio(ra, l2_lines);
+    // L2 ratio is local to the L1 misses, as in printMemoryStats
+    double l2_hit = l1_hit < 1.0 && l2_reach > l1_hit ? (l2_reach - l1_hit) / (1.0 - l1_hit) : 0.0;
+
+    printf("\nPredicted Cache Performance (fully associative LRU):\n");
+    printf("L1 Hit Ratio: %.2f%% (%.0f lines)\n", l1_hit * 100.0, l1_lines);
+    printf("L2 Hit Ratio: %.2f%% (%.0f lines)\n", l2_hit * 100.0, l2_lines);
+}
+
+// Stream a trace through the analyzer; lines use the configured line size
+int runReuse(const HierarchyConfig *cfg, TraceReader *tr, double rate, FILE *csv) {
+    TraceRecord *batch = calloc(TRACE_BATCH, sizeof(TraceRecord));
+    ReuseAnalyzer ra;
+    int shift = log2i(cfg->line_size);
+    int n, failed = !batch || initReuse(&ra, rate) != 0;
+
+    double start = nowSeconds();
+    while (!failed && (n = traceNextBatch(tr, batch, TRACE_BATCH)) > 0)
+        for (int i = 0; i < n && !failed; i++)
+            failed = reuseAccess(&ra, batch[i].address >> shift) != 0;
+    double elapsed = nowSeconds() - start;
+    free(batch);
+    if (failed) {
+        perror("runReuse");
+        if (batch) freeReuse(&ra);
+        return -1;
+    }
+
+    printReuse(&ra, cfg, csv);
+    printf("Analysis Time: %.3f s (%.2f M accesses/s)\n", elapsed,
+           elapsed > 0 ? ra.accesses / elapsed / 1e6 : 0.0);
+    freeReuse(&ra);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#ifndef MEMORY_HIERARCHY_H
+#define MEMORY_HIERARCHY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Cache/memory hierarchy simulator: per-core L1/L2, shared main memory with a
+// page table, optional MESI coherence, prefetchers and address translation.
+// Each MemoryHierarchy is an independent instance built from a runtime
+// HierarchyConfig; nothing is kept in globals.
+
+// Multi-core: private L1/L2 per core kept coherent with MESI over a snooping
+// bus, main memory shared
+#define MAX_CORES 64                // core sets are uint64_t bit masks
+
+// Replacement policies, selectable per level
+enum { POLICY_LRU, POLICY_PLRU, POLICY_RRIP };
+
+// Prefetchers train on each core's L1 misses. Next-line and stride fill L2,
+// stream buffers sit beside L2 and hand lines straight to L1.
+enum { PREFETCH_NONE, PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_STREAM };
+#define PREFETCH_DEGREE 2           // lines per trigger, depth of a stream buffer
+#define MAX_PREFETCH_DEGREE 16
+
+// Sweeps: configurations are run by a pool of forked workers
+#define MAX_SWEEP 4096
+#define SPEC_LEN 256
+
+// Traces: text lines "[core] R|W <addr>" (addr in C notation, 0x.. for hex) or
+// binary little-endian uint64 records with bit 63 set for writes, the core in
+// bits 56..62 and the address below
+#define TRACE_BATCH 4096
+#define TRACE_WRITE_BIT (1ULL << 63)
+#define TRACE_CORE_SHIFT 56
+#define TRACE_CORE_MASK 0x7f
+#define TRACE_ADDRESS_MASK ((1ULL << TRACE_CORE_SHIFT) - 1)
+
+// Everything that shapes a simulated hierarchy
+typedef struct {
+    int l1_sets;
+    int l1_ways;
+    int l2_sets;
+    int l2_ways;
+    int line_size;
+    int memory_frames;
+    int page_size;
+    int virtual_pages;
+    int l1_time;
+    int l2_time;
+    int memory_time;
+    int disk_time;
+    int upgrade_time;
+    int transfer_time;              // cache-to-cache
+    int policies[3];                // L1, L2, main memory
+    int write_back;                 // 0: write-through caches
+    int write_allocate;             // 0: write misses bypass L1/L2
+    int num_cores;
+    int prefetcher;
+    int prefetch_degree;
+    int tlb_page_bits;              // 12 or 21, 0 leaves translation out
+    uint64_t seed;                  // initial memory contents and synthetic workloads
+} HierarchyConfig;
+
+typedef struct MemoryHierarchy MemoryHierarchy;
+
+typedef struct {
+    unsigned long address;
+    int is_write;
+    int core;
+} TraceRecord;
+
+typedef struct {
+    FILE *fp;                       // text trace, streamed
+    const uint64_t *records;        // binary trace, memory-mapped
+    size_t count;
+    size_t pos;
+    size_t released;                // records already dropped from the mapping
+    unsigned long line_no;
+    unsigned long reads;
+    unsigned long writes;
+    int shared;                     // records are shared by sweep workers: keep them mapped
+    int owned;                      // records were malloc'ed by traceLoad
+} TraceReader;
+
+//  Random numbers: xoshiro256** (Blackman & Vigna) seeded through splitmix64.
+//  rngJump advances a generator by 2^128 draws, so the streams split off one
+//  seed never overlap and a run is the same on every host and libc.
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+void rngSeed(Rng *rng, uint64_t seed);
+void rngJump(Rng *rng);
+
+static inline uint64_t rngNext(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// Uniform in [0, n) by multiply-shift, no division
+static inline uint64_t rngBelow(Rng *rng, uint64_t n) {
+    return (uint64_t)(((unsigned __int128)rngNext(rng) * n) >> 64);
+}
+
+// Synthetic workload: 90% of the accesses fall in a working set at the bottom
+// of the address space, the rest anywhere in virtual memory; 30% are writes.
+// Each core draws from its own stream, so its accesses depend only on the
+// seed and its id, not on how many cores run or in which order.
+typedef struct {
+    Rng streams[MAX_CORES];
+    int cores;
+    int next_core;                  // cores take turns, one access each
+    unsigned long working_set;
+    unsigned long space;            // addresses in virtual memory
+} Workload;
+
+void workloadInit(Workload *w, const HierarchyConfig *cfg, unsigned long working_set);
+void workloadBatch(Workload *w, TraceRecord *records, int n);
+
+// Counters summed over every core
+typedef struct {
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long cycles;           // access time charged to the cores
+    unsigned long l1_hits;
+    unsigned long l1_misses;
+    unsigned long l2_hits;
+    unsigned long l2_misses;
+    unsigned long page_faults;
+    unsigned long writebacks;       // dirty lines and pages written down
+    unsigned long coherence_misses;
+    unsigned long prefetches;
+    unsigned long useful_prefetches;
+    unsigned long dtlb_hits;
+    unsigned long dtlb_misses;
+    unsigned long stlb_misses;
+    unsigned long walk_cycles;
+} HierarchyStats;
+
+//  Configuration
+void defaultConfig(HierarchyConfig *cfg);
+int checkConfig(const HierarchyConfig *cfg);            // 0, or -1 with a message
+int applyConfig(HierarchyConfig *cfg, const char *spec); // "key=value,..."
+int parsePolicy(const char *name);
+int parsePolicies(const char *arg, int policies[3]);
+int parsePrefetcher(const char *name);
+int parseTlb(const char *value);
+// Expand "key=a|b,key=c|d" into every combination, appended at specs[count];
+// returns the new count or -1
+int expandSpec(const char *spec, char specs[][SPEC_LEN], int count);
+
+//  Simulation
+// NULL if the configuration does not pass checkConfig or memory runs out
+MemoryHierarchy *createHierarchy(const HierarchyConfig *cfg);
+void destroyHierarchy(MemoryHierarchy *mh);
+// Cycles taken by one access
+int accessMemory(MemoryHierarchy *mh, int core_id, unsigned long address, int data,
+                 int is_write);
+// Replays n records (records of cores beyond the configuration are skipped)
+// and returns the cycles taken
+unsigned long accessBatch(MemoryHierarchy *mh, const TraceRecord *records, int n);
+void getHierarchyStats(const MemoryHierarchy *mh, HierarchyStats *stats);
+void printMemoryStats(MemoryHierarchy *mh);
+
+//  Traces
+int traceOpenText(TraceReader *tr, const char *path);   // "-" reads stdin
+int traceOpenBinary(TraceReader *tr, const char *path);
+// The whole trace as shared binary records, for repeated replays
+int traceLoad(TraceReader *tr, const char *path, int binary);
+int traceNextBatch(TraceReader *tr, TraceRecord batch[], int max);
+void traceClose(TraceReader *tr);
+
+//  Drivers that print a report
+int runTrace(MemoryHierarchy *mh, TraceReader *tr);
+int runSampled(const HierarchyConfig *cfg, const TraceReader *tr, double target);
+int runSweep(const HierarchyConfig *base, char specs[][SPEC_LEN], int count,
+             const TraceReader *trace, int jobs, FILE *csv);
+int runReuse(const HierarchyConfig *cfg, TraceReader *tr, double rate, FILE *csv);
+
+#endif
@@ -2,269 +2,160 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "page_replacement.h"
 
-typedef struct {   //simulate FIFO replacement
-    int *frames;              
-    int frame_count;          
-    int filled_frames_count;                 
-    int stack_pointer;        
-} FIFOQueue;
 
-
-typedef struct {    //Used in LRU algorithm
-    int page_num;      
-    int last_used;   
-} PageFrame;
-
-
-//Helper function for logging the memory status each time a page is referenced
-void Frames_Logger(int frames[], int frame_count) {
-    printf("[");
-    for (int i = 0; i < frame_count; i++) {
-        if (frames[i] == -1)
-            printf(" - ");
-        else
-            printf(" %d ", frames[i]);
-        if (i < frame_count - 1) printf("|");
-    }
-    printf("]");
-}
-
-
-void fifoPageReplacement(int pages[], int n, int frame_count) {
-    int *frames = (int *)malloc(sizeof(int) * frame_count);
-    for (int i = 0; i < frame_count; i++)
-        frames[i] = -1; // Initialize all frames as empty
-
-    FIFOQueue q;
-    q.frames = frames;
-    q.frame_count = frame_count;
-    q.filled_frames_count = 0;
-    q.stack_pointer = 0;
-
-    int pageFaults = 0;
-
-    for (int i = 0; i < n; i++) {
-        int page_num = pages[i];
-        bool page_in_mem = false;
-
-        // Check if page is already in memory
-        for (int j = 0; j < q.frame_count; j++) {
-            if (q.frames[j] == page_num) {
-                page_in_mem = true;
-                break;    //we break here bacause we have found the page in the memory and no need to check other frames
-            }
-        }
-
-        printf("Access page %d: ", page_num);   //this is for Logging purpose.
-
-        if (page_in_mem) {
-            printf("this page is in memory\t");
-            Frames_Logger(q.frames, q.frame_count);
-            printf("\n");
-            continue;   // no need to execute the rest of the code in the main loop because the page is found.
+// MAIN FUNCTION
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        // ./main bench [max_references] [frames]
+        long max_n = argc > 2 ? atol(argv[2]) : 10000000;
+        int frames = argc > 3 ? atoi(argv[3]) : 1000;
+        if (max_n < 1000 || max_n > INT_MAX || frames < 1) {
+            fprintf(stderr, "usage: %s bench [max_references (1000 .. %d)] [frames]\n", argv[0],
+                    INT_MAX);
+            return 1;
         }
-
-        // Page fault occurs
-        pageFaults++;
-
-        
-        q.frames[q.stack_pointer] = page_num; // Replace page at the stack_pointer position
-        q.stack_pointer = (q.stack_pointer + 1) % q.frame_count;  //and then update the pointer of the stack.
-
-        if (q.filled_frames_count < q.frame_count)
-            q.filled_frames_count++;
-
-        printf("PAGE FAULT\t");
-        Frames_Logger(q.frames, q.frame_count);
-        printf("\n");
-    }
-
-    printf("Total Page Faults = %d\n", pageFaults);
-    free(frames);
-}
-
-
-void lruPageReplacement(int pages[], int n, int frame_count) {
-    PageFrame *frames = (PageFrame *)malloc(sizeof(PageFrame) * frame_count);
-    // this is initialization:
-    for (int i = 0; i < frame_count; i++) {
-        frames[i].page_num = -1;     // Empty frame
-        frames[i].last_used = 0;
+        return benchmarkOptimal(max_n, frames);
     }
-
-    int timeCounter = 0;
-    int pageFaults = 0;
-
-    for (int i = 0; i < n; i++) {
-        int page_num = pages[i];
-        timeCounter++;
-        bool page_in_mem = false;
-
-        // Check if page exists and update access time
-        for (int j = 0; j < frame_count; j++) {
-            if (frames[j].page_num == page_num) {
-                frames[j].last_used = timeCounter;
-                page_in_mem = true;
-                break;
-            }
+    if (argc > 1 && strcmp(argv[1], "compare") == 0) {
+        // ./main compare [references] [frames]
+        int n = argc > 2 ? atoi(argv[2]) : 1000000;
+        int frames = argc > 3 ? atoi(argv[3]) : 1000;
+        if (n < 1 || frames < 1) {
+            fprintf(stderr, "usage: %s compare [references] [frames]\n", argv[0]);
+            return 1;
         }
-
-        printf("Access page %d: ", page_num);
-
-        if (page_in_mem) {
-            printf("page_in_mem\t");
-            int frames_currentstatus[frame_count];
-            for (int k = 0; k < frame_count; k++)
-                frames_currentstatus[k] = frames[k].page_num;
-            Frames_Logger(frames_currentstatus, frame_count);
-            printf("\n");
-            continue;
-        }
-
-        // Page fault occurs
-        pageFaults++;
-
-        // Look for an empty frame
-        int emptyIndex = -1;
-        for (int j = 0; j < frame_count; j++) {
-            if (frames[j].page_num == -1) {
-                emptyIndex = j;
-                break;
-            }
-        }
-
-        if (emptyIndex != -1) {
-            frames[emptyIndex].page_num = page_num;
-            frames[emptyIndex].last_used = timeCounter;
-        } else {
-            // Find least recently used page
-            int lruIndex = 0;
-            int minTime = frames[0].last_used;
-
-            for (int j = 1; j < frame_count; j++) {
-                if (frames[j].last_used < minTime) {
-                    minTime = frames[j].last_used;
-                    lruIndex = j;
-                }
-            }
-
-            frames[lruIndex].page_num = page_num;
-            frames[lruIndex].last_used = timeCounter;
-        }
-
-        int frames_currentstatus[frame_count];
-        for (int k = 0; k < frame_count; k++)
-            frames_currentstatus[k] = frames[k].page_num;
-
-        printf("PAGE FAULT\t");
-        Frames_Logger(frames_currentstatus, frame_count);
-        printf("\n");
+        return comparePolicies(n, frames);
     }
-
-    printf("Total Page Faults = %d\n", pageFaults);
-    free(frames);
-}
-
-
-void optimalPageReplacement(int pages[], int n, int frame_count) {
-    int *frames = (int *)malloc(sizeof(int) * frame_count);
-    for (int i = 0; i < frame_count; i++)
-        frames[i] = -1;
-
-    int pageFaults = 0;
-
-    for (int i = 0; i < n; i++) {
-        int page = pages[i];
-        bool page_in_mem = false;
-
-        // Check if page is already in memory
-        for (int j = 0; j < frame_count; j++) {
-            if (frames[j] == page) {
-                page_in_mem = true;
-                break;
-            }
+    if (argc > 1 && strcmp(argv[1], "curve") == 0) {
+        // ./main curve [references|belady] [max_frames] [jobs] [policies]
+        static int belady[] = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};
+        bool classic = argc > 2 && strcmp(argv[2], "belady") == 0;
+        int n = classic ? (int)(sizeof(belady) / sizeof(belady[0]))
+                        : (argc > 2 ? atoi(argv[2]) : 1000000);
+        int max_frames = argc > 3 ? atoi(argv[3]) : (classic ? 5 : 100);
+        int jobs = argc > 4 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        const char *names = argc > 5 ? argv[5] : "FIFO";
+        if (n < 1 || max_frames < 1) {
+            fprintf(stderr, "usage: %s curve [references|belady] [max_frames] [jobs] "
+                    "[policies, e.g. FIFO,CLOCK,ARC]\n", argv[0]);
+            return 1;
         }
-
-        printf("Access page %d: ", page);
-
-        if (page_in_mem) {
-            printf("page_in_mem\t");
-            Frames_Logger(frames, frame_count);
-            printf("\n");
-            continue;
+        int *pages = classic ? belady : (int *)malloc(sizeof(int) * n);
+        if (pages == NULL) {
+            fprintf(stderr, "cannot allocate %d references\n", n);
+            return 1;
         }
+        if (!classic)
+            mixedTrace(pages, n, max_frames / 2 > 0 ? max_frames / 2 : 1);
+        int rc = faultCurves(pages, n, max_frames, jobs, names);
+        if (!classic)
+            free(pages);
+        return rc;
+    }
 
-        // Page fault occurs
-        pageFaults++;
-
-        // Check for empty frame
-        int emptyIndex = -1;
-        for (int j = 0; j < frame_count; j++) {
-            if (frames[j] == -1) {
-                emptyIndex = j;
-                break;
-            }
+    if (argc > 1 && strcmp(argv[1], "multi") == 0) {
+        // ./main multi [max_processes] [frames] [references_per_process] [working_set]
+        int max_processes = argc > 2 ? atoi(argv[2]) : 12;
+        int frames = argc > 3 ? atoi(argv[3]) : 1000;
+        long references = argc > 4 ? atol(argv[4]) : 100000;
+        int working_set = argc > 5 ? atoi(argv[5]) : 150;
+        if (max_processes < 1 || max_processes > MULTI_MAX_PROCESSES || frames < max_processes ||
+            references < 1 || working_set < 1 || working_set >= 1 << 20) {
+            fprintf(stderr, "usage: %s multi [max_processes (1 .. %d)] [frames (>= processes)] "
+                    "[references_per_process] [working_set]\n", argv[0], MULTI_MAX_PROCESSES);
+            return 1;
         }
-
-        if (emptyIndex != -1)
-        {
-            frames[emptyIndex] = page;
+        return multiprogramming(max_processes, frames, references, working_set);
+    }
+    if (argc > 1 && strcmp(argv[1], "decode") == 0) {
+        // ./main decode events.bin [summary]
+        if (argc < 3) {
+            fprintf(stderr, "usage: %s decode events.bin [summary]\n", argv[0]);
+            return 1;
         }
-        else
-        {
-            int replaceIndex = -1;  //this is the index of the frame which its page will be replaced with the page now we have on the reference string.
-            int farthest = -1;    //from all the pages we have in the frames this will be updated to the page that will be referenced in the farthest future.
-
-            // Find the page with farthest next use
-            for (int j = 0; j < frame_count; j++) {  //at the end of this loop we will have the final replaceindex and farthest variables value.
-                int nextUse;
-                for (nextUse = i + 1; nextUse < n; nextUse++) {
-                    if (frames[j] == pages[nextUse])
-                        break;    //if we find a page which will be referenced in the future ,we save its index which is nextuse variable(index shows the time which it will be reference in the future)
-                }
-
-                if (nextUse >= n) {     // this is the case that we have found the best candidate frame the page we have to be replaced here.(no need to check other pages in the frames so we break)
-                    replaceIndex = j;
-                    break;  
-                }
-
-                if (nextUse > farthest) {   //this is the time we update the two variables (farthest and replaceindex so we can update them on the next iterations of the loop)
-                    farthest = nextUse;
-                    replaceIndex = j;
-                }
-            }
-
-            if (replaceIndex == -1)
-                replaceIndex = 0;
+        return decodeEvents(argv[2], argc > 3 && strcmp(argv[3], "summary") == 0);
+    }
 
-            frames[replaceIndex] = page;
+    static SimulationLog log;
+    log.verbosity = LOG_SUMMARY;
+    const char *events_path = NULL;
+    int frame_count = 4;
+    int generated = 0;
+    const char *input_path = NULL, *generator = NULL;
+    int window = 1 << 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "v:e:f:n:i:g:w:")) != -1) {
+        switch (opt) {
+            case 'v': log.verbosity = atoi(optarg); break;
+            case 'e': events_path = optarg; break;
+            case 'f': frame_count = atoi(optarg); break;
+            case 'n': generated = atoi(optarg); break;
+            case 'i': input_path = optarg; break;
+            case 'g': generator = optarg; break;
+            case 'w': window = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-v 0-3 (quiet, summary, faults, every step)] "
+                        "[-e events.bin] [-f frames] [-n generated_references]\n"
+                        "       %s -i trace(.bin|.txt) | -g generator [-n references] [-f frames] "
+                        "[-w opt_lookahead]\n"
+                        "       %s bench|compare|curve|decode ...\n", argv[0], argv[0], argv[0]);
+                return 1;
         }
+    }
+    if (frame_count < 1 || generated < 0) {
+        fprintf(stderr, "frames must be positive\n");
+        return 1;
+    }
 
-        printf("PAGE FAULT\t");
-        Frames_Logger(frames, frame_count);
-        printf("\n");
+    if (input_path != NULL || generator != NULL) {
+        //streaming mode: every policy and windowed OPT, summaries only
+        ReferenceStream stream;
+        long length = generated > 0 ? generated : 10000000;
+        int rc = input_path != NULL ? streamOpenFile(&stream, input_path)
+                                    : streamOpenGenerator(&stream, generator, length, 42);
+        if (rc != 0)
+            return 1;
+        if (window < frame_count)
+            window = frame_count;
+        compareStream(&stream, frame_count, window);
+        streamClose(&stream);
+        return 0;
     }
 
-    printf("Total Page Faults = %d\n", pageFaults);
-    free(frames);
-}
+    int demo[] = {7, 0, 1, 2, 0, 3, 0, 4, 2, 3, 0, 3, 2};
+    int *pages = demo;
+    int n = sizeof(demo) / sizeof(demo[0]);    // this is the number of pages that our process has.
+    if (generated > 0) {
+        pages = (int *)malloc(sizeof(int) * generated);
+        n = generated;
+        mixedTrace(pages, n, frame_count);
+    }
 
-// MAIN FUNCTION
-int main() {
-    int pages[] = {7, 0, 1, 2, 0, 3, 0, 4, 2, 3, 0, 3, 2};
-    int n = sizeof(pages) / sizeof(pages[0]);    // this is the number of pages that our process has.
-    int frame_count = 4;  
+    if (events_path != NULL && (log.events = fopen(events_path, "wb")) == NULL) {
+        perror(events_path);
+        return 1;
+    }
+    static char out_buffer[1 << 16];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));   //per-step lines go out in blocks
 
-    printf("FIFO Algorithm:\n");
-    fifoPageReplacement(pages, n, frame_count);
+    bool headers = log.verbosity >= LOG_SUMMARY;
+    if (headers) printf("FIFO Algorithm:\n");
+    fifoPageReplacement(pages, n, frame_count, &log);
 
-    printf("\nLRU Algorithm:\n");
-    lruPageReplacement(pages, n, frame_count);
+    if (headers) printf("\nLRU Algorithm:\n");
+    lruPageReplacement(pages, n, frame_count, &log);
 
-    printf("\nOptimal Algorithm:\n");
-    optimalPageReplacement(pages, n, frame_count);
+    if (headers) printf("\nOptimal Algorithm:\n");
+    optimalPageReplacement(pages, n, frame_count, &log);
 
+    if (log.events != NULL)
+        fclose(log.events);
+    if (pages != demo)
+        free(pages);
     return 0;
 }
\ No newline at end of file
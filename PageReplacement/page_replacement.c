@@ -0,0 +1,2437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "page_replacement.h"
+
+
+typedef struct {   //simulate FIFO replacement
+    int *frames;              
+    int frame_count;          
+    int filled_frames_count;                 
+    int stack_pointer;        
+} FIFOQueue;
+
+
+typedef struct {    //Used in LRU algorithm
+    int page_num;      
+    int last_used;   
+} PageFrame;
+
+
+typedef struct {    //page -> frame hash index, so a hit check does not scan the frames
+    int *pages;               //open addressing with linear probing, -1 marks a free slot
+    int *frames;
+    int mask;                 //capacity - 1, capacity is a power of two
+    int count;
+} PageIndex;
+
+
+typedef struct {    //recency list over frame numbers, most recently used at the head
+    int *prev;
+    int *next;
+    int head;
+    int tail;
+} LRUList;
+
+
+//splitmix64: every generator carries its own state, so streams seeded apart stay apart
+static uint64_t randomNext(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+//uniform in [0, n)
+static int randomBelow(uint64_t *state, int n) {
+    return (int)(((unsigned __int128)randomNext(state) * (uint64_t)n) >> 64);
+}
+
+
+static double randomUnit(uint64_t *state) {
+    return (randomNext(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+static void pageIndexInit(PageIndex *index, int frame_count) {
+    int capacity = 4;
+    while (capacity < 2 * frame_count)   //keep the load factor at or below one half
+        capacity <<= 1;
+    index->pages = (int *)malloc(sizeof(int) * capacity);
+    index->frames = (int *)malloc(sizeof(int) * capacity);
+    index->mask = capacity - 1;
+    index->count = 0;
+    for (int i = 0; i < capacity; i++)
+        index->pages[i] = -1;
+}
+
+
+static void pageIndexFree(PageIndex *index) {
+    free(index->pages);
+    free(index->frames);
+}
+
+
+static unsigned int pageHash(int page_num) {
+    return (unsigned int)page_num * 2654435769u;   //Fibonacci hashing spreads sequential page numbers
+}
+
+
+//returns the frame holding the page, or -1 if the page is not in memory
+static int pageIndexFind(const PageIndex *index, int page_num) {
+    unsigned int slot = pageHash(page_num) & index->mask;
+    while (index->pages[slot] != -1) {
+        if (index->pages[slot] == page_num)
+            return index->frames[slot];
+        slot = (slot + 1) & index->mask;
+    }
+    return -1;
+}
+
+
+static void pageIndexInsert(PageIndex *index, int page_num, int frame);
+
+
+//doubles the table once it is half full, only tables keyed by more pages than frames need it
+static void pageIndexGrow(PageIndex *index) {
+    PageIndex old = *index;
+    pageIndexInit(index, old.mask + 1);
+    for (int i = 0; i <= old.mask; i++)
+        if (old.pages[i] != -1)
+            pageIndexInsert(index, old.pages[i], old.frames[i]);
+    pageIndexFree(&old);
+}
+
+
+static void pageIndexInsert(PageIndex *index, int page_num, int frame) {
+    if (2 * (index->count + 1) > index->mask + 1)
+        pageIndexGrow(index);
+    index->count++;
+    unsigned int slot = pageHash(page_num) & index->mask;
+    while (index->pages[slot] != -1)
+        slot = (slot + 1) & index->mask;
+    index->pages[slot] = page_num;
+    index->frames[slot] = frame;
+}
+
+
+static void pageIndexRemove(PageIndex *index, int page_num) {
+    unsigned int slot = pageHash(page_num) & index->mask;
+    while (index->pages[slot] != page_num) {
+        if (index->pages[slot] == -1)
+            return;
+        slot = (slot + 1) & index->mask;
+    }
+
+    //shift later entries of the probe run back so lookups never stop early (no tombstones)
+    unsigned int hole = slot;
+    for (;;) {
+        slot = (slot + 1) & index->mask;
+        if (index->pages[slot] == -1)
+            break;
+        unsigned int home = pageHash(index->pages[slot]) & index->mask;
+        if (((slot - home) & index->mask) >= ((slot - hole) & index->mask)) {
+            index->pages[hole] = index->pages[slot];
+            index->frames[hole] = index->frames[slot];
+            hole = slot;
+        }
+    }
+    index->pages[hole] = -1;
+    index->count--;
+}
+
+
+static void lruListInit(LRUList *list, int frame_count) {
+    list->prev = (int *)malloc(sizeof(int) * frame_count);
+    list->next = (int *)malloc(sizeof(int) * frame_count);
+    list->head = -1;
+    list->tail = -1;
+}
+
+
+static void lruListFree(LRUList *list) {
+    free(list->prev);
+    free(list->next);
+}
+
+
+static void lruListUnlink(LRUList *list, int frame) {
+    if (list->prev[frame] != -1) list->next[list->prev[frame]] = list->next[frame];
+    else list->head = list->next[frame];
+    if (list->next[frame] != -1) list->prev[list->next[frame]] = list->prev[frame];
+    else list->tail = list->prev[frame];
+}
+
+
+static void lruListPushFront(LRUList *list, int frame) {
+    list->prev[frame] = -1;
+    list->next[frame] = list->head;
+    if (list->head != -1) list->prev[list->head] = frame;
+    else list->tail = frame;
+    list->head = frame;
+}
+
+
+//Helper function for logging the memory status each time a page is referenced
+static void Frames_Logger(int frames[], int frame_count) {
+    printf("[");
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i] == -1)
+            printf(" - ");
+        else
+            printf(" %d ", frames[i]);
+        if (i < frame_count - 1) printf("|");
+    }
+    printf("]");
+}
+
+
+static const char *algorithmNames[] = {"FIFO", "LRU", "Optimal"};
+static const char *hitMessages[] = {"this page is in memory", "page_in_mem", "page_in_mem"};
+
+
+static void logFlushEvents(SimulationLog *log) {
+    if (log->buffered > 0)
+        fwrite(log->buffer, sizeof(PageEvent), log->buffered, log->events);
+    log->buffered = 0;
+}
+
+
+static void logEvent(SimulationLog *log, uint32_t index, int page, int victim) {
+    PageEvent *e = &log->buffer[log->buffered++];
+    e->index = index;
+    e->page = page;
+    e->victim = victim;
+    if (log->buffered == EVENT_BUFFER)
+        logFlushEvents(log);
+}
+
+
+static void logRunStart(SimulationLog *log, int algorithm, int frame_count) {
+    log->algorithm = algorithm;
+    log->buffered = 0;
+    if (log->events != NULL)
+        logEvent(log, PAGE_EVENT_RUN, frame_count, algorithm);
+}
+
+
+//Called for every reference; does nothing unless steps are printed or events recorded
+static inline void logReference(SimulationLog *log, int i, int page, bool hit, int victim,
+                                int frames[], int frame_count) {
+    if (log == NULL)
+        return;
+    if (log->events != NULL)
+        logEvent(log, (uint32_t)i | (hit ? PAGE_EVENT_HIT : 0), page, victim);
+    if (log->verbosity >= LOG_STEPS || (log->verbosity == LOG_FAULTS && !hit)) {
+        printf("Access page %d: %s\t", page, hit ? hitMessages[log->algorithm] : "PAGE FAULT");
+        Frames_Logger(frames, frame_count);
+        printf("\n");
+    }
+}
+
+
+static void logRunEnd(SimulationLog *log, int pageFaults) {
+    if (log->events != NULL)
+        logFlushEvents(log);
+    if (log->verbosity >= LOG_SUMMARY)
+        printf("Total Page Faults = %d\n", pageFaults);
+}
+
+
+//Prints an event log written with -e, one line per event or only a summary per run
+int decodeEvents(const char *path, bool summary_only) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    PageEvent *batch = (PageEvent *)malloc(sizeof(PageEvent) * EVENT_BUFFER);
+    long hits = 0, faults = 0, evictions = 0;
+    bool in_run = false;
+    size_t got;
+    while ((got = fread(batch, sizeof(PageEvent), EVENT_BUFFER, in)) > 0) {
+        for (size_t k = 0; k < got; k++) {
+            PageEvent *e = &batch[k];
+            if (e->index == PAGE_EVENT_RUN) {
+                if (in_run)
+                    printf("hits %ld, page faults %ld, evictions %ld\n\n", hits, faults, evictions);
+                hits = faults = evictions = 0;
+                in_run = true;
+                bool known = e->victim >= 0 && e->victim <= ALGORITHM_OPT;
+                printf("%s, %d frames:\n", known ? algorithmNames[e->victim] : "unknown", e->page);
+                continue;
+            }
+            bool hit = e->index & PAGE_EVENT_HIT;
+            hits += hit;
+            faults += !hit;
+            evictions += e->victim != -1;
+            if (summary_only)
+                continue;
+            printf("%u: page %d %s", e->index & ~PAGE_EVENT_HIT, e->page, hit ? "hit" : "FAULT");
+            if (e->victim != -1)
+                printf(", evicted %d", e->victim);
+            printf("\n");
+        }
+    }
+    if (in_run)
+        printf("hits %ld, page faults %ld, evictions %ld\n", hits, faults, evictions);
+    free(batch);
+    fclose(in);
+    return 0;
+}
+
+
+void fifoPageReplacement(int pages[], int n, int frame_count, SimulationLog *log) {
+    int *frames = (int *)malloc(sizeof(int) * frame_count);
+    for (int i = 0; i < frame_count; i++)
+        frames[i] = -1; // Initialize all frames as empty
+
+    FIFOQueue q;
+    q.frames = frames;
+    q.frame_count = frame_count;
+    q.filled_frames_count = 0;
+    q.stack_pointer = 0;
+    logRunStart(log, ALGORITHM_FIFO, frame_count);
+
+    PageIndex index;
+    pageIndexInit(&index, frame_count);
+
+    int pageFaults = 0;
+
+    for (int i = 0; i < n; i++) {
+        int page_num = pages[i];
+
+        // Check if page is already in memory
+        bool page_in_mem = pageIndexFind(&index, page_num) != -1;
+
+        if (page_in_mem) {
+            logReference(log, i, page_num, true, -1, q.frames, q.frame_count);
+            continue;   // no need to execute the rest of the code in the main loop because the page is found.
+        }
+
+        // Page fault occurs
+        pageFaults++;
+
+        int victim = q.frames[q.stack_pointer];
+        if (victim != -1)
+            pageIndexRemove(&index, victim);
+        pageIndexInsert(&index, page_num, q.stack_pointer);
+        q.frames[q.stack_pointer] = page_num; // Replace page at the stack_pointer position
+        q.stack_pointer = (q.stack_pointer + 1) % q.frame_count;  //and then update the pointer of the stack.
+
+        if (q.filled_frames_count < q.frame_count)
+            q.filled_frames_count++;
+
+        logReference(log, i, page_num, false, victim, q.frames, q.frame_count);
+    }
+
+    logRunEnd(log, pageFaults);
+    pageIndexFree(&index);
+    free(frames);
+}
+
+
+void lruPageReplacement(int pages[], int n, int frame_count, SimulationLog *log) {
+    PageFrame *frames = (PageFrame *)malloc(sizeof(PageFrame) * frame_count);
+    // this is initialization:
+    for (int i = 0; i < frame_count; i++) {
+        frames[i].page_num = -1;     // Empty frame
+        frames[i].last_used = 0;
+    }
+
+    PageIndex index;
+    pageIndexInit(&index, frame_count);
+    LRUList recency;        //its tail is the frame with the smallest last_used
+    lruListInit(&recency, frame_count);
+    int filled = 0;         //frames are filled in order and never emptied
+    int *resident = (int *)malloc(sizeof(int) * frame_count);   //page_num of each frame, for the log
+    for (int i = 0; i < frame_count; i++)
+        resident[i] = -1;
+    logRunStart(log, ALGORITHM_LRU, frame_count);
+
+    int timeCounter = 0;
+    int pageFaults = 0;
+
+    for (int i = 0; i < n; i++) {
+        int page_num = pages[i];
+        timeCounter++;
+        bool page_in_mem = false;
+
+        // Check if page exists and update access time
+        int frame = pageIndexFind(&index, page_num);
+        if (frame != -1) {
+            frames[frame].last_used = timeCounter;
+            lruListUnlink(&recency, frame);
+            lruListPushFront(&recency, frame);
+            page_in_mem = true;
+        }
+
+        if (page_in_mem) {
+            logReference(log, i, page_num, true, -1, resident, frame_count);
+            continue;
+        }
+
+        // Page fault occurs
+        pageFaults++;
+
+        // Look for an empty frame
+        int victim = -1;
+        if (filled < frame_count) {
+            frame = filled++;
+        } else {
+            // The least recently used page is at the tail of the list
+            frame = recency.tail;
+            lruListUnlink(&recency, frame);
+            victim = frames[frame].page_num;
+            pageIndexRemove(&index, victim);
+        }
+
+        frames[frame].page_num = page_num;
+        frames[frame].last_used = timeCounter;
+        pageIndexInsert(&index, page_num, frame);
+        lruListPushFront(&recency, frame);
+        resident[frame] = page_num;
+
+        logReference(log, i, page_num, false, victim, resident, frame_count);
+    }
+
+    logRunEnd(log, pageFaults);
+    free(resident);
+    lruListFree(&recency);
+    pageIndexFree(&index);
+    free(frames);
+}
+
+
+//next_use[i] is the position of the next reference to pages[i], or n if there is none.
+//One backward pass with a page -> latest position map.
+static int *computeNextUse(int pages[], int n) {
+    int *next_use = (int *)malloc(sizeof(int) * (n > 0 ? n : 1));
+    PageIndex latest;
+    pageIndexInit(&latest, 1024);   //grows with the number of distinct pages
+
+    for (int i = n - 1; i >= 0; i--) {
+        int pos = pageIndexFind(&latest, pages[i]);
+        next_use[i] = pos == -1 ? n : pos;
+        if (pos != -1)
+            pageIndexRemove(&latest, pages[i]);
+        pageIndexInsert(&latest, pages[i], i);
+    }
+
+    pageIndexFree(&latest);
+    return next_use;
+}
+
+
+typedef struct {    //max-heap of resident frames keyed by the next use of their page
+    int *heap;                //heap position -> frame
+    int *pos;                 //frame -> heap position
+    long *key;                //frame -> next use
+    int size;
+} NextUseHeap;
+
+
+static void heapSwap(NextUseHeap *h, int a, int b) {
+    int fa = h->heap[a], fb = h->heap[b];
+    h->heap[a] = fb;
+    h->heap[b] = fa;
+    h->pos[fb] = a;
+    h->pos[fa] = b;
+}
+
+
+static void heapSiftUp(NextUseHeap *h, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (h->key[h->heap[parent]] >= h->key[h->heap[i]])
+            break;
+        heapSwap(h, i, parent);
+        i = parent;
+    }
+}
+
+
+static void heapSiftDown(NextUseHeap *h, int i) {
+    for (;;) {
+        int largest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < h->size && h->key[h->heap[left]] > h->key[h->heap[largest]])
+            largest = left;
+        if (right < h->size && h->key[h->heap[right]] > h->key[h->heap[largest]])
+            largest = right;
+        if (largest == i)
+            break;
+        heapSwap(h, i, largest);
+        i = largest;
+    }
+}
+
+
+//Pages that are never used again all sort above every real next use, lower frames first,
+//so the victim is the same frame the scanning version picked.
+static int nextUseKey(int next_use, int n, int frame, int frame_count) {
+    return next_use < n ? next_use : n + frame_count - frame;
+}
+
+
+//Belady's OPT in O(n log frames): a fault evicts the heap root, a hit raises the page's key.
+//Reports each reference to log unless it is NULL, and returns the number of page faults.
+int optimalRun(int pages[], int n, int frame_count, SimulationLog *log) {
+    int *frames = (int *)malloc(sizeof(int) * frame_count);
+    for (int i = 0; i < frame_count; i++)
+        frames[i] = -1;
+
+    int *next_use = computeNextUse(pages, n);
+    PageIndex index;
+    pageIndexInit(&index, frame_count);
+    NextUseHeap h;
+    h.heap = (int *)malloc(sizeof(int) * frame_count);
+    h.pos = (int *)malloc(sizeof(int) * frame_count);
+    h.key = (long *)malloc(sizeof(long) * frame_count);
+    h.size = 0;
+
+    int pageFaults = 0;
+
+    for (int i = 0; i < n; i++) {
+        int page = pages[i];
+        int frame = pageIndexFind(&index, page);
+
+        if (frame != -1) {
+            h.key[frame] = nextUseKey(next_use[i], n, frame, frame_count);
+            heapSiftUp(&h, h.pos[frame]);
+            logReference(log, i, page, true, -1, frames, frame_count);
+            continue;
+        }
+
+        // Page fault occurs
+        pageFaults++;
+
+        int victim = -1;
+        if (h.size < frame_count) {
+            // frames fill in order and are never emptied, so this is the first empty one
+            frame = h.size;
+            h.heap[h.size] = frame;
+            h.pos[frame] = h.size++;
+            h.key[frame] = nextUseKey(next_use[i], n, frame, frame_count);
+            heapSiftUp(&h, h.pos[frame]);
+        } else {
+            // the root holds the page used farthest in the future
+            frame = h.heap[0];
+            victim = frames[frame];
+            pageIndexRemove(&index, victim);
+            h.key[frame] = nextUseKey(next_use[i], n, frame, frame_count);
+            heapSiftDown(&h, 0);
+        }
+        frames[frame] = page;
+        pageIndexInsert(&index, page, frame);
+
+        logReference(log, i, page, false, victim, frames, frame_count);
+    }
+
+    free(h.heap);
+    free(h.pos);
+    free(h.key);
+    pageIndexFree(&index);
+    free(next_use);
+    free(frames);
+    return pageFaults;
+}
+
+
+void optimalPageReplacement(int pages[], int n, int frame_count, SimulationLog *log) {
+    logRunStart(log, ALGORITHM_OPT, frame_count);
+    int pageFaults = optimalRun(pages, n, frame_count, log);
+    logRunEnd(log, pageFaults);
+}
+
+
+//The original OPT: on every fault, scan ahead from i for each resident page.
+//O(n * frames * n) in the worst case, kept as the reference for the benchmark.
+static int optimalScanFaults(int pages[], int n, int frame_count) {
+    int *frames = (int *)malloc(sizeof(int) * frame_count);
+    for (int i = 0; i < frame_count; i++)
+        frames[i] = -1;
+
+    int pageFaults = 0;
+
+    for (int i = 0; i < n; i++) {
+        int page = pages[i];
+        bool page_in_mem = false;
+
+        for (int j = 0; j < frame_count; j++) {
+            if (frames[j] == page) {
+                page_in_mem = true;
+                break;
+            }
+        }
+        if (page_in_mem)
+            continue;
+
+        pageFaults++;
+
+        int replaceIndex = -1;
+        for (int j = 0; j < frame_count; j++) {
+            if (frames[j] == -1) {      // empty frame
+                replaceIndex = j;
+                break;
+            }
+        }
+
+        if (replaceIndex == -1) {
+            int farthest = -1;
+            for (int j = 0; j < frame_count; j++) {
+                int nextUse;
+                for (nextUse = i + 1; nextUse < n; nextUse++) {
+                    if (frames[j] == pages[nextUse])
+                        break;
+                }
+                if (nextUse >= n) {
+                    replaceIndex = j;
+                    break;
+                }
+                if (nextUse > farthest) {
+                    farthest = nextUse;
+                    replaceIndex = j;
+                }
+            }
+        }
+
+        frames[replaceIndex] = page;
+    }
+
+    free(frames);
+    return pageFaults;
+}
+
+
+static double elapsedSeconds(struct timespec start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+//Times OPT on synthetic traces of 10^3 .. max_n references. The scanning version runs
+//alongside up to 10^5 references and must report the same fault count.
+int benchmarkOptimal(long max_n, int frame_count) {
+    printf("%12s %8s %12s %12s %12s %12s\n", "references", "frames", "faults", "heap (s)",
+           "scan (s)", "M refs/s");
+
+    for (long n = 1000; n <= max_n; n *= 10) {
+        int *pages = (int *)malloc(sizeof(int) * n);
+        if (pages == NULL) {
+            fprintf(stderr, "cannot allocate %ld references\n", n);
+            return 1;
+        }
+        // 90% of references go to a hot set twice the size of memory, the rest anywhere
+        uint64_t random = 42;
+        int hot = 2 * frame_count, cold = 100 * frame_count;
+        for (long i = 0; i < n; i++)
+            pages[i] = randomBelow(&random, 10) < 9 ? randomBelow(&random, hot)
+                                                     : randomBelow(&random, cold);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int faults = optimalRun(pages, (int)n, frame_count, NULL);
+        double heap_time = elapsedSeconds(start);
+
+        char scan[32] = "-";
+        if (n <= 100000) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int scan_faults = optimalScanFaults(pages, (int)n, frame_count);
+            double scan_time = elapsedSeconds(start);
+            if (scan_faults != faults) {
+                fprintf(stderr, "fault counts differ at n = %ld: heap %d, scan %d\n", n, faults,
+                        scan_faults);
+                free(pages);
+                return 1;
+            }
+            snprintf(scan, sizeof(scan), "%.4f", scan_time);
+        }
+
+        printf("%12ld %8d %12d %12.4f %12s %12.2f\n", n, frame_count, faults, heap_time, scan,
+               heap_time > 0 ? n / heap_time / 1e6 : 0.0);
+        fflush(stdout);
+        free(pages);
+    }
+    return 0;
+}
+
+typedef struct {    //page nodes that can sit on two lists at once, for policies that keep history
+    int *page;
+    int *prev[2];
+    int *next[2];
+    unsigned char *state;
+    unsigned char *ref;
+    int free_head;
+} NodePool;
+
+
+typedef struct {    //newest node at the head, oldest at the tail
+    int head;
+    int tail;
+    int size;
+    int link;       //which of the node's two link pairs this list uses
+} NodeList;
+
+
+static void nodePoolInit(NodePool *pool, int capacity) {
+    pool->page = (int *)malloc(sizeof(int) * capacity);
+    for (int l = 0; l < 2; l++) {
+        pool->prev[l] = (int *)malloc(sizeof(int) * capacity);
+        pool->next[l] = (int *)malloc(sizeof(int) * capacity);
+    }
+    pool->state = (unsigned char *)calloc(capacity, 1);
+    pool->ref = (unsigned char *)calloc(capacity, 1);
+    for (int i = 0; i < capacity; i++)
+        pool->next[0][i] = i + 1 < capacity ? i + 1 : -1;
+    pool->free_head = 0;
+}
+
+
+static void nodePoolFree(NodePool *pool) {
+    free(pool->page);
+    for (int l = 0; l < 2; l++) {
+        free(pool->prev[l]);
+        free(pool->next[l]);
+    }
+    free(pool->state);
+    free(pool->ref);
+}
+
+
+static int nodeNew(NodePool *pool, int page) {
+    int node = pool->free_head;
+    pool->free_head = pool->next[0][node];
+    pool->page[node] = page;
+    pool->state[node] = 0;
+    pool->ref[node] = 0;
+    return node;
+}
+
+
+static void nodeDelete(NodePool *pool, int node) {
+    pool->next[0][node] = pool->free_head;
+    pool->free_head = node;
+}
+
+
+static void nodeListInit(NodeList *list, int link) {
+    list->head = -1;
+    list->tail = -1;
+    list->size = 0;
+    list->link = link;
+}
+
+
+static void nodeListPushHead(NodePool *pool, NodeList *list, int node) {
+    int *prev = pool->prev[list->link], *next = pool->next[list->link];
+    prev[node] = -1;
+    next[node] = list->head;
+    if (list->head != -1) prev[list->head] = node;
+    else list->tail = node;
+    list->head = node;
+    list->size++;
+}
+
+
+static void nodeListUnlink(NodePool *pool, NodeList *list, int node) {
+    int *prev = pool->prev[list->link], *next = pool->next[list->link];
+    if (prev[node] != -1) next[prev[node]] = next[node];
+    else list->head = next[node];
+    if (next[node] != -1) prev[next[node]] = prev[node];
+    else list->tail = prev[node];
+    list->size--;
+}
+
+
+//  FIFO and LRU, the O(1) versions of the logging simulators above
+
+typedef struct {
+    int *frames;
+    int frame_count;
+    int hand;
+    PageIndex index;
+} FIFOPolicy;
+
+
+static void *fifoCreate(int frame_count) {
+    FIFOPolicy *p = (FIFOPolicy *)malloc(sizeof(FIFOPolicy));
+    p->frames = (int *)malloc(sizeof(int) * frame_count);
+    for (int i = 0; i < frame_count; i++)
+        p->frames[i] = -1;
+    p->frame_count = frame_count;
+    p->hand = 0;
+    pageIndexInit(&p->index, frame_count);
+    return p;
+}
+
+
+static bool fifoReference(void *policy, int page, int *victim) {
+    FIFOPolicy *p = (FIFOPolicy *)policy;
+    *victim = -1;
+    if (pageIndexFind(&p->index, page) != -1)
+        return true;
+
+    *victim = p->frames[p->hand];
+    if (*victim != -1)
+        pageIndexRemove(&p->index, *victim);
+    p->frames[p->hand] = page;
+    pageIndexInsert(&p->index, page, p->hand);
+    p->hand = (p->hand + 1) % p->frame_count;
+    return false;
+}
+
+
+static void fifoDestroy(void *policy) {
+    FIFOPolicy *p = (FIFOPolicy *)policy;
+    pageIndexFree(&p->index);
+    free(p->frames);
+    free(p);
+}
+
+
+typedef struct {
+    int *frames;
+    int frame_count;
+    int filled;
+    PageIndex index;
+    LRUList recency;
+} LRUPolicy;
+
+
+static void *lruCreate(int frame_count) {
+    LRUPolicy *p = (LRUPolicy *)malloc(sizeof(LRUPolicy));
+    p->frames = (int *)malloc(sizeof(int) * frame_count);
+    p->frame_count = frame_count;
+    p->filled = 0;
+    pageIndexInit(&p->index, frame_count);
+    lruListInit(&p->recency, frame_count);
+    return p;
+}
+
+
+static bool lruReference(void *policy, int page, int *victim) {
+    LRUPolicy *p = (LRUPolicy *)policy;
+    *victim = -1;
+    int frame = pageIndexFind(&p->index, page);
+    if (frame != -1) {
+        lruListUnlink(&p->recency, frame);
+        lruListPushFront(&p->recency, frame);
+        return true;
+    }
+
+    if (p->filled < p->frame_count) {
+        frame = p->filled++;
+    } else {
+        frame = p->recency.tail;
+        lruListUnlink(&p->recency, frame);
+        *victim = p->frames[frame];
+        pageIndexRemove(&p->index, *victim);
+    }
+    p->frames[frame] = page;
+    pageIndexInsert(&p->index, page, frame);
+    lruListPushFront(&p->recency, frame);
+    return false;
+}
+
+
+static void lruDestroy(void *policy) {
+    LRUPolicy *p = (LRUPolicy *)policy;
+    lruListFree(&p->recency);
+    pageIndexFree(&p->index);
+    free(p->frames);
+    free(p);
+}
+
+
+//  CLOCK (second chance): FIFO order, but a page referenced since the hand last passed
+//  has its bit cleared and is skipped once
+
+typedef struct {
+    int *frames;
+    unsigned char *ref;
+    int frame_count;
+    int hand;
+    PageIndex index;
+} ClockPolicy;
+
+
+static void *clockCreate(int frame_count) {
+    ClockPolicy *p = (ClockPolicy *)malloc(sizeof(ClockPolicy));
+    p->frames = (int *)malloc(sizeof(int) * frame_count);
+    p->ref = (unsigned char *)calloc(frame_count, 1);
+    for (int i = 0; i < frame_count; i++)
+        p->frames[i] = -1;
+    p->frame_count = frame_count;
+    p->hand = 0;
+    pageIndexInit(&p->index, frame_count);
+    return p;
+}
+
+
+static bool clockReference(void *policy, int page, int *victim) {
+    ClockPolicy *p = (ClockPolicy *)policy;
+    *victim = -1;
+    int frame = pageIndexFind(&p->index, page);
+    if (frame != -1) {
+        p->ref[frame] = 1;
+        return true;
+    }
+
+    while (p->frames[p->hand] != -1 && p->ref[p->hand]) {   //at most one lap
+        p->ref[p->hand] = 0;
+        p->hand = (p->hand + 1) % p->frame_count;
+    }
+    *victim = p->frames[p->hand];
+    if (*victim != -1)
+        pageIndexRemove(&p->index, *victim);
+    p->frames[p->hand] = page;
+    p->ref[p->hand] = 1;        //the faulting reference sets the bit like any other
+    pageIndexInsert(&p->index, page, p->hand);
+    p->hand = (p->hand + 1) % p->frame_count;
+    return false;
+}
+
+
+static void clockDestroy(void *policy) {
+    ClockPolicy *p = (ClockPolicy *)policy;
+    pageIndexFree(&p->index);
+    free(p->frames);
+    free(p->ref);
+    free(p);
+}
+
+
+//  2Q (Johnson & Shasha): first references go to the FIFO A1in, pages referenced again
+//  after leaving it (found in the ghost queue A1out) are promoted to the LRU queue Am
+
+typedef struct {
+    NodePool pool;
+    PageIndex index;          //page -> node, for resident pages and A1out ghosts
+    NodeList a1in, a1out, am;
+    int frame_count;
+    int kin;                  //A1in target, 25% of memory
+    int kout;                 //A1out length, remembers 50% of memory in pages
+} TwoQPolicy;
+
+enum { TWOQ_A1IN = 1, TWOQ_A1OUT, TWOQ_AM };
+
+
+static void *twoQCreate(int frame_count) {
+    TwoQPolicy *p = (TwoQPolicy *)malloc(sizeof(TwoQPolicy));
+    p->frame_count = frame_count;
+    p->kin = frame_count / 4 > 0 ? frame_count / 4 : 1;
+    p->kout = frame_count / 2 > 0 ? frame_count / 2 : 1;
+    nodePoolInit(&p->pool, frame_count + p->kout + 1);
+    pageIndexInit(&p->index, frame_count + p->kout);
+    nodeListInit(&p->a1in, 0);
+    nodeListInit(&p->a1out, 0);
+    nodeListInit(&p->am, 0);
+    return p;
+}
+
+
+//frees a frame: A1in gives up its oldest page while it is over its share, otherwise Am its LRU
+static int twoQReclaim(TwoQPolicy *p) {
+    if (p->a1in.size + p->am.size < p->frame_count)
+        return -1;
+
+    if (p->a1in.size > p->kin || p->am.size == 0) {
+        int node = p->a1in.tail;
+        int page = p->pool.page[node];
+        nodeListUnlink(&p->pool, &p->a1in, node);
+        p->pool.state[node] = TWOQ_A1OUT;
+        nodeListPushHead(&p->pool, &p->a1out, node);
+        if (p->a1out.size > p->kout) {
+            int old = p->a1out.tail;
+            nodeListUnlink(&p->pool, &p->a1out, old);
+            pageIndexRemove(&p->index, p->pool.page[old]);
+            nodeDelete(&p->pool, old);
+        }
+        return page;
+    }
+
+    int node = p->am.tail;
+    int page = p->pool.page[node];
+    nodeListUnlink(&p->pool, &p->am, node);
+    pageIndexRemove(&p->index, page);
+    nodeDelete(&p->pool, node);
+    return page;
+}
+
+
+static bool twoQReference(void *policy, int page, int *victim) {
+    TwoQPolicy *p = (TwoQPolicy *)policy;
+    *victim = -1;
+    int node = pageIndexFind(&p->index, page);
+
+    if (node != -1 && p->pool.state[node] == TWOQ_AM) {
+        nodeListUnlink(&p->pool, &p->am, node);
+        nodeListPushHead(&p->pool, &p->am, node);
+        return true;
+    }
+    if (node != -1 && p->pool.state[node] == TWOQ_A1IN)
+        return true;    //correlated references inside A1in do not promote
+
+    if (node != -1) {
+        //ghost hit: the page was reused after A1in let it go
+        nodeListUnlink(&p->pool, &p->a1out, node);
+        pageIndexRemove(&p->index, page);
+        nodeDelete(&p->pool, node);
+        *victim = twoQReclaim(p);
+        node = nodeNew(&p->pool, page);
+        p->pool.state[node] = TWOQ_AM;
+        nodeListPushHead(&p->pool, &p->am, node);
+    } else {
+        *victim = twoQReclaim(p);
+        node = nodeNew(&p->pool, page);
+        p->pool.state[node] = TWOQ_A1IN;
+        nodeListPushHead(&p->pool, &p->a1in, node);
+    }
+    pageIndexInsert(&p->index, page, node);
+    return false;
+}
+
+
+static void twoQDestroy(void *policy) {
+    TwoQPolicy *p = (TwoQPolicy *)policy;
+    nodePoolFree(&p->pool);
+    pageIndexFree(&p->index);
+    free(p);
+}
+
+
+//  ARC (Megiddo & Modha): T1 holds pages seen once, T2 pages seen at least twice, and the
+//  ghost lists B1 and B2 move the target size p of T1 towards whichever side misses more
+
+typedef struct {
+    NodePool pool;
+    PageIndex index;          //page -> node, for T1, T2, B1 and B2
+    NodeList t1, t2, b1, b2;
+    int frame_count;
+    int target;               //p, the target size of T1
+} ARCPolicy;
+
+enum { ARC_T1 = 1, ARC_T2, ARC_B1, ARC_B2 };
+
+
+static void *arcCreate(int frame_count) {
+    ARCPolicy *p = (ARCPolicy *)malloc(sizeof(ARCPolicy));
+    p->frame_count = frame_count;
+    p->target = 0;
+    nodePoolInit(&p->pool, 2 * frame_count + 1);
+    pageIndexInit(&p->index, 2 * frame_count);
+    nodeListInit(&p->t1, 0);
+    nodeListInit(&p->t2, 0);
+    nodeListInit(&p->b1, 0);
+    nodeListInit(&p->b2, 0);
+    return p;
+}
+
+
+static void arcMove(ARCPolicy *p, int node, NodeList *from, NodeList *to, int state) {
+    nodeListUnlink(&p->pool, from, node);
+    p->pool.state[node] = state;
+    nodeListPushHead(&p->pool, to, node);
+}
+
+
+static void arcDrop(ARCPolicy *p, NodeList *list) {
+    int node = list->tail;
+    nodeListUnlink(&p->pool, list, node);
+    pageIndexRemove(&p->index, p->pool.page[node]);
+    nodeDelete(&p->pool, node);
+}
+
+
+//REPLACE: evict the LRU page of T1 or T2 into its ghost list, returns the evicted page
+static int arcReplace(ARCPolicy *p, bool in_b2) {
+    int node;
+    if (p->t1.size > 0 && ((in_b2 && p->t1.size == p->target) || p->t1.size > p->target)) {
+        node = p->t1.tail;
+        arcMove(p, node, &p->t1, &p->b1, ARC_B1);
+    } else {
+        node = p->t2.tail;
+        arcMove(p, node, &p->t2, &p->b2, ARC_B2);
+    }
+    return p->pool.page[node];
+}
+
+
+static bool arcReference(void *policy, int page, int *victim) {
+    ARCPolicy *p = (ARCPolicy *)policy;
+    int c = p->frame_count;
+    *victim = -1;
+    int node = pageIndexFind(&p->index, page);
+    int state = node != -1 ? p->pool.state[node] : 0;
+
+    if (state == ARC_T1 || state == ARC_T2) {
+        arcMove(p, node, state == ARC_T1 ? &p->t1 : &p->t2, &p->t2, ARC_T2);
+        return true;
+    }
+
+    if (state == ARC_B1) {
+        int delta = p->b2.size / p->b1.size > 1 ? p->b2.size / p->b1.size : 1;
+        p->target = p->target + delta < c ? p->target + delta : c;
+        *victim = arcReplace(p, false);
+        arcMove(p, node, &p->b1, &p->t2, ARC_T2);
+        return false;
+    }
+    if (state == ARC_B2) {
+        int delta = p->b1.size / p->b2.size > 1 ? p->b1.size / p->b2.size : 1;
+        p->target = p->target - delta > 0 ? p->target - delta : 0;
+        *victim = arcReplace(p, true);
+        arcMove(p, node, &p->b2, &p->t2, ARC_T2);
+        return false;
+    }
+
+    //not in the cache or the history
+    int l1 = p->t1.size + p->b1.size;
+    int total = l1 + p->t2.size + p->b2.size;
+    if (l1 == c) {
+        if (p->t1.size < c) {
+            arcDrop(p, &p->b1);
+            *victim = arcReplace(p, false);
+        } else {
+            *victim = p->pool.page[p->t1.tail];
+            arcDrop(p, &p->t1);
+        }
+    } else if (total >= c) {
+        if (total == 2 * c)
+            arcDrop(p, &p->b2);
+        if (p->t1.size + p->t2.size == c)
+            *victim = arcReplace(p, false);
+    }
+
+    node = nodeNew(&p->pool, page);
+    p->pool.state[node] = ARC_T1;
+    nodeListPushHead(&p->pool, &p->t1, node);
+    pageIndexInsert(&p->index, page, node);
+    return false;
+}
+
+
+static void arcDestroy(void *policy) {
+    ARCPolicy *p = (ARCPolicy *)policy;
+    nodePoolFree(&p->pool);
+    pageIndexFree(&p->index);
+    free(p);
+}
+
+
+//  LIRS (Jiang & Zhang): pages with a short inter-reference recency (LIR) keep most of
+//  memory, the rest (HIR) cycle through a small queue. The stack S orders pages by recency
+//  and ends with an LIR page; Q holds the resident HIR pages.
+
+typedef struct {
+    NodePool pool;
+    PageIndex index;          //page -> node, for every page in S or Q
+    NodeList stack;           //S, link 0
+    NodeList queue;           //Q, link 1
+    NodeList ghosts;          //non-resident HIR pages still in S, oldest at the tail, link 1
+    int frame_count;
+    int lir_limit;            //Llirs, memory minus the 1% HIR share
+    int lir_count;
+    int resident;
+} LIRSPolicy;
+
+enum { LIRS_LIR = 1, LIRS_HIR, LIRS_GHOST };
+#define LIRS_IN_STACK 1       //in pool.ref: the node is on S
+
+
+static void *lirsCreate(int frame_count) {
+    LIRSPolicy *p = (LIRSPolicy *)malloc(sizeof(LIRSPolicy));
+    int hir = frame_count / 100 > 0 ? frame_count / 100 : 1;
+    p->frame_count = frame_count;
+    p->lir_limit = frame_count - hir;
+    p->lir_count = 0;
+    p->resident = 0;
+    //at most frame_count ghosts are kept, the oldest is forgotten first
+    nodePoolInit(&p->pool, 2 * frame_count + 1);
+    pageIndexInit(&p->index, 2 * frame_count);
+    nodeListInit(&p->stack, 0);
+    nodeListInit(&p->queue, 1);
+    nodeListInit(&p->ghosts, 1);
+    return p;
+}
+
+
+static void lirsForget(LIRSPolicy *p, int node) {
+    pageIndexRemove(&p->index, p->pool.page[node]);
+    nodeDelete(&p->pool, node);
+}
+
+
+static void lirsStackRemove(LIRSPolicy *p, int node) {
+    nodeListUnlink(&p->pool, &p->stack, node);
+    p->pool.ref[node] = 0;
+    if (p->pool.state[node] == LIRS_GHOST) {
+        nodeListUnlink(&p->pool, &p->ghosts, node);
+        lirsForget(p, node);
+    }
+}
+
+
+static void lirsStackPush(LIRSPolicy *p, int node) {
+    if (p->pool.ref[node] == LIRS_IN_STACK)
+        nodeListUnlink(&p->pool, &p->stack, node);
+    p->pool.ref[node] = LIRS_IN_STACK;
+    nodeListPushHead(&p->pool, &p->stack, node);
+}
+
+
+//stack pruning: S must end with an LIR page
+static void lirsPrune(LIRSPolicy *p) {
+    while (p->stack.tail != -1 && p->pool.state[p->stack.tail] != LIRS_LIR)
+        lirsStackRemove(p, p->stack.tail);
+}
+
+
+//the LIR page at the bottom of S becomes a resident HIR page at the end of Q
+static void lirsDemoteBottom(LIRSPolicy *p) {
+    lirsPrune(p);       //with no LIR page left S may end in HIR pages
+    int node = p->stack.tail;
+    lirsStackRemove(p, node);
+    p->pool.state[node] = LIRS_HIR;
+    p->lir_count--;
+    nodeListPushHead(&p->pool, &p->queue, node);
+    lirsPrune(p);
+}
+
+
+static void lirsPromote(LIRSPolicy *p, int node) {
+    p->pool.state[node] = LIRS_LIR;
+    p->lir_count++;
+    lirsStackPush(p, node);
+    if (p->lir_count > p->lir_limit)
+        lirsDemoteBottom(p);
+}
+
+
+static bool lirsReference(void *policy, int page, int *victim) {
+    LIRSPolicy *p = (LIRSPolicy *)policy;
+    *victim = -1;
+    int node = pageIndexFind(&p->index, page);
+    int state = node != -1 ? p->pool.state[node] : 0;
+
+    if (state == LIRS_LIR) {
+        bool bottom = node == p->stack.tail;
+        lirsStackPush(p, node);
+        if (bottom)
+            lirsPrune(p);
+        return true;
+    }
+    if (state == LIRS_HIR) {
+        if (p->pool.ref[node] == LIRS_IN_STACK) {
+            //reused within the LIR recency: it becomes LIR
+            nodeListUnlink(&p->pool, &p->queue, node);
+            lirsPromote(p, node);
+        } else {
+            lirsStackPush(p, node);
+            nodeListUnlink(&p->pool, &p->queue, node);
+            nodeListPushHead(&p->pool, &p->queue, node);
+        }
+        return true;
+    }
+
+    //page fault
+    bool ghost = state == LIRS_GHOST;
+    if (ghost) {
+        //take it off the ghost list first, so freeing a frame cannot forget it
+        nodeListUnlink(&p->pool, &p->ghosts, node);
+        p->pool.state[node] = LIRS_HIR;
+    }
+    if (p->resident == p->frame_count) {
+        int out = p->queue.tail;
+        *victim = p->pool.page[out];
+        nodeListUnlink(&p->pool, &p->queue, out);
+        if (p->pool.ref[out] == LIRS_IN_STACK) {
+            p->pool.state[out] = LIRS_GHOST;
+            nodeListPushHead(&p->pool, &p->ghosts, out);
+            if (p->ghosts.size > p->frame_count) {
+                int old = p->ghosts.tail;
+                nodeListUnlink(&p->pool, &p->stack, old);
+                nodeListUnlink(&p->pool, &p->ghosts, old);
+                lirsForget(p, old);
+            }
+        } else {
+            lirsForget(p, out);
+        }
+        p->resident--;
+    }
+    p->resident++;
+
+    if (ghost) {
+        //still on S, so its reuse distance beats the bottom LIR page
+        lirsPromote(p, node);
+        return false;
+    }
+
+    node = nodeNew(&p->pool, page);
+    pageIndexInsert(&p->index, page, node);
+    if (p->lir_count < p->lir_limit) {
+        p->pool.state[node] = LIRS_LIR;   //warm-up: LIR until the LIR share is full
+        p->lir_count++;
+        lirsStackPush(p, node);
+    } else {
+        p->pool.state[node] = LIRS_HIR;
+        lirsStackPush(p, node);
+        nodeListPushHead(&p->pool, &p->queue, node);
+    }
+    return false;
+}
+
+
+static void lirsDestroy(void *policy) {
+    LIRSPolicy *p = (LIRSPolicy *)policy;
+    nodePoolFree(&p->pool);
+    pageIndexFree(&p->index);
+    free(p);
+}
+
+
+//  CLOCK-Pro (Jiang, Chen & Zhang): one clock holds hot pages, cold resident pages and
+//  non-resident cold pages still in their test period. HAND_cold evicts, HAND_hot demotes,
+//  HAND_test ends test periods; the cold share adapts to test-period hits.
+
+typedef struct {
+    NodePool pool;            //circular list on link 0
+    PageIndex index;          //page -> node, for every page on the clock
+    int hand_hot, hand_cold, hand_test;
+    int count_hot, count_cold, count_test;
+    int frame_count;
+    int cold_target;          //mc, the frames meant for cold pages
+    int cold_min;             //1% of memory, as LIRS keeps for HIR pages
+    int evicted;              //last page HAND_cold took out of memory
+} ClockProPolicy;
+
+enum { CLOCKPRO_HOT = 1, CLOCKPRO_COLD, CLOCKPRO_TEST };
+
+
+static void *clockProCreate(int frame_count) {
+    ClockProPolicy *p = (ClockProPolicy *)malloc(sizeof(ClockProPolicy));
+    nodePoolInit(&p->pool, 2 * frame_count + 1);
+    pageIndexInit(&p->index, 2 * frame_count);
+    p->hand_hot = p->hand_cold = p->hand_test = -1;
+    p->count_hot = p->count_cold = p->count_test = 0;
+    p->frame_count = frame_count;
+    p->cold_target = frame_count;
+    p->cold_min = frame_count / 100 > 0 ? frame_count / 100 : 1;
+    p->evicted = -1;
+    return p;
+}
+
+
+static int clockProNext(ClockProPolicy *p, int node) {
+    return p->pool.next[0][node];
+}
+
+
+//new pages go just behind HAND_hot, the last place any hand reaches
+static void clockProInsert(ClockProPolicy *p, int node) {
+    int *prev = p->pool.prev[0], *next = p->pool.next[0];
+    if (p->hand_hot == -1) {
+        prev[node] = next[node] = node;
+        p->hand_hot = p->hand_cold = p->hand_test = node;
+        return;
+    }
+    int after = prev[p->hand_hot];
+    prev[node] = after;
+    next[node] = p->hand_hot;
+    next[after] = node;
+    prev[p->hand_hot] = node;
+}
+
+
+static void clockProRemove(ClockProPolicy *p, int node) {
+    int *prev = p->pool.prev[0], *next = p->pool.next[0];
+    int successor = next[node] != node ? next[node] : -1;
+    if (p->hand_hot == node) p->hand_hot = successor;
+    if (p->hand_cold == node) p->hand_cold = successor;
+    if (p->hand_test == node) p->hand_test = successor;
+    next[prev[node]] = next[node];
+    prev[next[node]] = prev[node];
+    pageIndexRemove(&p->index, p->pool.page[node]);
+    nodeDelete(&p->pool, node);
+}
+
+
+//HAND_hot: an unreferenced hot page is demoted, a referenced one loses its bit, and a
+//non-resident cold page it passes has outlived its test period
+static void clockProHandHot(ClockProPolicy *p) {
+    int node = p->hand_hot;
+    p->hand_hot = clockProNext(p, node);
+    if (p->pool.state[node] == CLOCKPRO_HOT) {
+        if (p->pool.ref[node]) {
+            p->pool.ref[node] = 0;
+        } else {
+            p->pool.state[node] = CLOCKPRO_COLD;
+            p->count_hot--;
+            p->count_cold++;
+        }
+    } else if (p->pool.state[node] == CLOCKPRO_TEST) {
+        clockProRemove(p, node);
+        p->count_test--;
+        if (p->cold_target > p->cold_min)
+            p->cold_target--;     //the test period passed without a reuse
+    }
+}
+
+
+//HAND_test: forgets the next non-resident cold page once too many are remembered
+static void clockProHandTest(ClockProPolicy *p) {
+    for (;;) {
+        int node = p->hand_test;
+        p->hand_test = clockProNext(p, node);
+        if (p->pool.state[node] == CLOCKPRO_TEST) {
+            clockProRemove(p, node);
+            p->count_test--;
+            if (p->cold_target > p->cold_min)
+                p->cold_target--;
+            return;
+        }
+    }
+}
+
+
+//HAND_cold: a referenced cold page turns hot, an unreferenced one is evicted into its test
+//period. Hot pages over their share are demoted right away so a cold page is always ahead.
+static void clockProHandCold(ClockProPolicy *p) {
+    int node = p->hand_cold;
+    p->hand_cold = clockProNext(p, node);
+    if (p->pool.state[node] != CLOCKPRO_COLD)
+        return;
+
+    if (p->pool.ref[node]) {
+        p->pool.state[node] = CLOCKPRO_HOT;
+        p->pool.ref[node] = 0;
+        p->count_cold--;
+        p->count_hot++;
+        while (p->count_hot > p->frame_count - p->cold_target)
+            clockProHandHot(p);
+    } else {
+        p->pool.state[node] = CLOCKPRO_TEST;
+        p->evicted = p->pool.page[node];
+        p->count_cold--;
+        p->count_test++;
+        if (p->count_test > p->frame_count)
+            clockProHandTest(p);
+    }
+}
+
+
+static bool clockProReference(void *policy, int page, int *victim) {
+    ClockProPolicy *p = (ClockProPolicy *)policy;
+    *victim = -1;
+    int node = pageIndexFind(&p->index, page);
+
+    if (node != -1 && p->pool.state[node] != CLOCKPRO_TEST) {
+        p->pool.ref[node] = 1;
+        return true;
+    }
+
+    int state = CLOCKPRO_COLD;
+    if (node != -1) {
+        //reused during its test period: it comes back hot and cold pages get more room
+        if (p->cold_target < p->frame_count)
+            p->cold_target++;
+        clockProRemove(p, node);
+        p->count_test--;
+        state = CLOCKPRO_HOT;
+    }
+
+    p->evicted = -1;
+    while (p->count_hot + p->count_cold >= p->frame_count)
+        clockProHandCold(p);
+    *victim = p->evicted;
+
+    node = nodeNew(&p->pool, page);
+    p->pool.state[node] = state;
+    clockProInsert(p, node);
+    pageIndexInsert(&p->index, page, node);
+    if (state == CLOCKPRO_HOT) p->count_hot++;
+    else p->count_cold++;
+    while (p->count_hot > p->frame_count - p->cold_target)
+        clockProHandHot(p);
+    return false;
+}
+
+
+static void clockProDestroy(void *policy) {
+    ClockProPolicy *p = (ClockProPolicy *)policy;
+    nodePoolFree(&p->pool);
+    pageIndexFree(&p->index);
+    free(p);
+}
+
+
+const ReplacementPolicy replacementPolicies[] = {
+    {"FIFO", fifoCreate, fifoReference, fifoDestroy},
+    {"LRU", lruCreate, lruReference, lruDestroy},
+    {"CLOCK", clockCreate, clockReference, clockDestroy},
+    {"2Q", twoQCreate, twoQReference, twoQDestroy},
+    {"ARC", arcCreate, arcReference, arcDestroy},
+    {"LIRS", lirsCreate, lirsReference, lirsDestroy},
+    {"CLOCK-Pro", clockProCreate, clockProReference, clockProDestroy},
+};
+const int policyCount = sizeof(replacementPolicies) / sizeof(replacementPolicies[0]);
+
+
+const ReplacementPolicy *findPolicy(const char *name) {
+    for (int k = 0; k < policyCount; k++)
+        if (strcmp(replacementPolicies[k].name, name) == 0)
+            return &replacementPolicies[k];
+    return NULL;
+}
+
+
+//Runs one policy over the trace and returns its page faults
+int policyRun(const ReplacementPolicy *policy, int pages[], int n, int frame_count) {
+    void *state = policy->create(frame_count);
+    int pageFaults = 0, victim;
+    for (int i = 0; i < n; i++)
+        if (!policy->reference(state, pages[i], &victim))
+            pageFaults++;
+    policy->destroy(state);
+    return pageFaults;
+}
+
+
+//A hot set that fits in memory, random references over a larger set and periodic
+//sequential scans: the mix where recency-only policies and scan-resistant ones part ways.
+void mixedTrace(int pages[], int n, int frame_count) {
+    int hot = frame_count / 2 > 0 ? frame_count / 2 : 1;
+    int warm = 4 * frame_count;
+    int next_scan_page = 1000000;   //scans touch pages nobody else does
+    uint64_t random = 42;
+    for (int i = 0; i < n;) {
+        if (randomBelow(&random, 10) == 0) {
+            int length = frame_count + randomBelow(&random, frame_count + 1);
+            for (int k = 0; k < length && i < n; k++)
+                pages[i++] = next_scan_page++;
+        } else {
+            for (int k = 0; k < 10 * frame_count && i < n; k++)
+                pages[i++] = randomBelow(&random, 10) < 7 ? randomBelow(&random, hot)
+                                                           : hot + randomBelow(&random, warm);
+        }
+    }
+}
+
+
+//Fault rate and per-reference cost of every policy, with OPT as the floor
+int comparePolicies(int n, int frame_count) {
+    int *pages = (int *)malloc(sizeof(int) * n);
+    if (pages == NULL) {
+        fprintf(stderr, "cannot allocate %d references\n", n);
+        return 1;
+    }
+    mixedTrace(pages, n, frame_count);
+
+    printf("%d references, %d frames\n", n, frame_count);
+    printf("%-10s %12s %12s %12s\n", "policy", "faults", "fault rate", "ns/ref");
+    for (int k = 0; k <= policyCount; k++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const char *name = k < policyCount ? replacementPolicies[k].name : "OPT";
+        int faults = k < policyCount ? policyRun(&replacementPolicies[k], pages, n, frame_count)
+                                     : optimalRun(pages, n, frame_count, NULL);
+        double seconds = elapsedSeconds(start);
+        printf("%-10s %12d %11.2f%% %12.1f\n", name, faults, 100.0 * faults / n,
+               seconds * 1e9 / n);
+    }
+    free(pages);
+    return 0;
+}
+
+//  Fault curves: faults for every memory size from 1 to max_frames
+
+//LRU is a stack algorithm: a reference hits in c frames exactly when fewer than c distinct
+//pages were used since the page's last reference (its stack distance). One pass counts those
+//pages with a Fenwick tree over last-use times; curve[c] = references with distance > c.
+int *lruFaultCurve(int pages[], int n, int max_frames) {
+    int *hist = (int *)calloc(max_frames + 2, sizeof(int));   //hist[d], d > max_frames at the end
+    int *tree = (int *)calloc(n + 1, sizeof(int));            //1 at the last use of each page
+    PageIndex last;
+    pageIndexInit(&last, 1024);
+
+    for (int i = 0; i < n; i++) {
+        int prev = pageIndexFind(&last, pages[i]);
+        int distance = max_frames + 1;       //first references miss at every size
+        if (prev != -1) {
+            int marks = 0;   //pages used after prev: all marks minus those up to prev
+            for (int t = i; t > 0; t -= t & -t)
+                marks += tree[t];
+            for (int t = prev + 1; t > 0; t -= t & -t)
+                marks -= tree[t];
+            if (marks + 1 <= max_frames)
+                distance = marks + 1;
+            for (int t = prev + 1; t <= n; t += t & -t)
+                tree[t]--;
+            pageIndexRemove(&last, pages[i]);
+        }
+        for (int t = i + 1; t <= n; t += t & -t)
+            tree[t]++;
+        pageIndexInsert(&last, pages[i], i);
+        hist[distance]++;
+    }
+
+    int *curve = (int *)calloc(max_frames + 1, sizeof(int));
+    int misses = hist[max_frames + 1];
+    for (int c = max_frames; c >= 1; c--) {
+        curve[c] = misses;
+        misses += hist[c];
+    }
+    curve[0] = n;
+
+    pageIndexFree(&last);
+    free(tree);
+    free(hist);
+    return curve;
+}
+
+
+//OPT is a stack algorithm too, with priority given by the next use (Mattson et al.). The
+//referenced page goes on top; below it, level by level down to where it was, the page used
+//sooner stays and the other one is carried down. Only the top max_frames levels matter.
+int *optFaultCurve(int pages[], int n, int max_frames) {
+    int *next_use = computeNextUse(pages, n);
+    int *stack = (int *)malloc(sizeof(int) * max_frames);
+    int *key = (int *)malloc(sizeof(int) * max_frames);       //next use of each stack page
+    int *hist = (int *)calloc(max_frames + 2, sizeof(int));
+    int depth = 0;
+
+    for (int i = 0; i < n; i++) {
+        int page = pages[i];
+        int d = 0;
+        while (d < depth && stack[d] != page)
+            d++;
+        hist[d < depth ? d + 1 : max_frames + 1]++;
+
+        //a hit refills the page's old level; a miss grows the stack until it holds max_frames
+        //pages, after which the bottom level takes part and the last carry drops out
+        int end = d;
+        if (d == depth && depth < max_frames)
+            depth++;
+        else if (d == depth)
+            end = depth;
+        int carry = page, carry_key = next_use[i];
+        for (int j = 0; j < end && j < depth; j++) {
+            //the referenced page takes the top; below it the page used later moves down
+            if (j == 0 || key[j] > carry_key) {
+                int t = stack[j], tk = key[j];
+                stack[j] = carry;
+                key[j] = carry_key;
+                carry = t;
+                carry_key = tk;
+            }
+        }
+        if (end < depth) {
+            stack[end] = carry;
+            key[end] = carry_key;
+        }
+    }
+
+    int *curve = (int *)calloc(max_frames + 1, sizeof(int));
+    int misses = hist[max_frames + 1];
+    for (int c = max_frames; c >= 1; c--) {
+        curve[c] = misses;
+        misses += hist[c];
+    }
+    curve[0] = n;
+
+    free(hist);
+    free(key);
+    free(stack);
+    free(next_use);
+    return curve;
+}
+
+
+//Runs every policy for the sizes max_frames - first, max_frames - first - step, ...
+//(largest first, they are the slowest)
+static void policyStride(const ReplacementPolicy *policies[], int count, int pages[], int n,
+                         int max_frames, int first, int step, int *faults) {
+    for (int c = max_frames - first; c >= 1; c -= step)
+        for (int k = 0; k < count; k++)
+            faults[k * (max_frames + 1) + c] = policyRun(policies[k], pages, n, c);
+}
+
+//Non-stack policies need a run per memory size. Workers forked off the trace take every
+//jobs-th size and write into a shared table, faults[k * (max_frames + 1) + c]. The sizes of
+//workers that cannot be forked are run in the calling process.
+int *policyFaultCurves(const ReplacementPolicy *policies[], int count, int pages[], int n,
+                       int max_frames, int jobs) {
+    size_t bytes = sizeof(int) * count * (max_frames + 1);
+    int *faults = (int *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                              -1, 0);
+    if (faults == MAP_FAILED)
+        return NULL;
+
+    if (jobs <= 1) {
+        policyStride(policies, count, pages, n, max_frames, 0, 1, faults);
+        return faults;
+    }
+
+    int started = 0;
+    for (; started < jobs; started++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            policyStride(policies, count, pages, n, max_frames, started, jobs, faults);
+            _exit(0);
+        }
+    }
+    for (int w = started; w < jobs; w++)
+        policyStride(policies, count, pages, n, max_frames, w, jobs, faults);
+
+    int failed = 0;
+    for (int w = 0; w < started; w++) {
+        int status;
+        if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed = 1;
+    }
+    if (failed) {
+        munmap(faults, bytes);
+        return NULL;
+    }
+    return faults;
+}
+
+
+//Prints the fault curves as CSV: one row per memory size with LRU, OPT and the requested
+//policies. A policy column is followed by an anomaly flag, set where adding a frame raised
+//its faults (Belady's anomaly); stack algorithms such as LRU and OPT can never show one.
+int faultCurves(int pages[], int n, int max_frames, int jobs, const char *names) {
+    const ReplacementPolicy *chosen[sizeof(replacementPolicies) / sizeof(replacementPolicies[0])];
+    int count = 0;
+
+    char list[256], *save;
+    snprintf(list, sizeof(list), "%s", names);
+    for (char *name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        const ReplacementPolicy *policy = findPolicy(name);
+        if (policy == NULL || strcmp(name, "LRU") == 0) {
+            fprintf(stderr, "unknown or stack policy '%s' (LRU and OPT are always included)\n",
+                    name);
+            return 1;
+        }
+        if (count < policyCount)
+            chosen[count++] = policy;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int *lru = lruFaultCurve(pages, n, max_frames);
+    int *opt = optFaultCurve(pages, n, max_frames);
+    double stack_time = elapsedSeconds(start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int *faults = count > 0 ? policyFaultCurves(chosen, count, pages, n, max_frames, jobs) : NULL;
+    double policy_time = elapsedSeconds(start);
+    if (count > 0 && faults == NULL) {
+        fprintf(stderr, "policy runs failed\n");
+        free(lru);
+        free(opt);
+        return 1;
+    }
+
+    printf("frames,LRU,OPT");
+    for (int k = 0; k < count; k++)
+        printf(",%s,%s_anomaly", chosen[k]->name, chosen[k]->name);
+    printf("\n");
+
+    int anomalies = 0;
+    for (int c = 1; c <= max_frames; c++) {
+        printf("%d,%d,%d", c, lru[c], opt[c]);
+        for (int k = 0; k < count; k++) {
+            int f = faults[k * (max_frames + 1) + c];
+            int anomaly = c > 1 && f > faults[k * (max_frames + 1) + c - 1];
+            anomalies += anomaly;
+            printf(",%d,%d", f, anomaly);
+        }
+        printf("\n");
+    }
+
+    fprintf(stderr, "%d references, 1..%d frames: LRU and OPT in one pass each (%.3f s), "
+            "%d other policies in %d runs on %d worker%s (%.3f s), %d anomalous points\n",
+            n, max_frames, stack_time, count, count * max_frames, jobs > 1 ? jobs : 1,
+            jobs > 1 ? "s" : "", policy_time, anomalies);
+
+    if (faults != NULL)
+        munmap(faults, sizeof(int) * count * (max_frames + 1));
+    free(lru);
+    free(opt);
+    return 0;
+}
+
+//  Streaming input: references come from a mapped file or a generator in chunks, so online
+//  policies run in memory independent of the trace length
+
+int streamOpenFile(ReferenceStream *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty or unreadable\n", path);
+        close(fd);
+        return -1;
+    }
+    s->size = (size_t)st.st_size;
+    s->data = (const unsigned char *)mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (s->data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    madvise((void *)s->data, s->size, MADV_SEQUENTIAL);
+
+    //binary traces are little-endian 32-bit page numbers in a .bin file
+    size_t len = strlen(path);
+    s->kind = len > 4 && strcmp(path + len - 4, ".bin") == 0 ? STREAM_BINARY : STREAM_TEXT;
+    if (s->kind == STREAM_BINARY)
+        s->size -= s->size % sizeof(int32_t);
+    return 0;
+}
+
+
+//Walker's alias method (Vose's construction): O(1) per Zipf draw, P(k) ~ 1 / (k + 1)^alpha
+static void zipfAliasTable(ReferenceStream *s) {
+    int n = s->pages;
+    s->accept = (double *)malloc(sizeof(double) * n);
+    s->alias = (int *)malloc(sizeof(int) * n);
+    int *small = (int *)malloc(sizeof(int) * n), *large = (int *)malloc(sizeof(int) * n);
+    int small_count = 0, large_count = 0;
+
+    double sum = 0;
+    for (int k = 0; k < n; k++)
+        sum += s->accept[k] = pow(k + 1, -s->alpha);
+    for (int k = 0; k < n; k++) {
+        s->accept[k] *= n / sum;        //scaled so the average column is 1
+        s->alias[k] = k;
+        if (s->accept[k] < 1.0) small[small_count++] = k;
+        else large[large_count++] = k;
+    }
+    while (small_count > 0 && large_count > 0) {
+        int lo = small[--small_count], hi = large[large_count - 1];
+        s->alias[lo] = hi;              //hi fills the rest of lo's column
+        s->accept[hi] -= 1.0 - s->accept[lo];
+        if (s->accept[hi] < 1.0) {
+            large_count--;
+            small[small_count++] = hi;
+        }
+    }
+    while (large_count > 0) s->accept[large[--large_count]] = 1.0;
+    while (small_count > 0) s->accept[small[--small_count]] = 1.0;   //rounding leftovers
+    free(small);
+    free(large);
+}
+
+
+//zipf:PAGES:ALPHA, loop:PAGES, scan:HOT:SCAN_LENGTH or phase:WORKING_SET:PHASE_LENGTH
+int streamOpenGenerator(ReferenceStream *s, const char *spec, long length, unsigned int seed) {
+    memset(s, 0, sizeof(*s));
+    char name[16];
+    double a = 0, b = 0;
+    int fields = sscanf(spec, "%15[a-z]:%lf:%lf", name, &a, &b);
+    s->length = length;
+    s->seed = seed;
+
+    if (fields == 3 && strcmp(name, "zipf") == 0 && a >= 1 && b > 0) {
+        s->kind = STREAM_ZIPF;
+        s->pages = (int)a;
+        s->alpha = b;
+        zipfAliasTable(s);
+    } else if (fields >= 2 && strcmp(name, "loop") == 0 && a >= 1) {
+        s->kind = STREAM_LOOP;
+        s->pages = (int)a;
+    } else if (fields == 3 && strcmp(name, "scan") == 0 && a >= 1 && b >= 1) {
+        s->kind = STREAM_SCAN;
+        s->pages = (int)a;
+        s->period = (int)b;
+    } else if (fields == 3 && strcmp(name, "phase") == 0 && a >= 1 && b >= 1) {
+        s->kind = STREAM_PHASE;
+        s->pages = (int)a;
+        s->period = (int)b;
+    } else {
+        fprintf(stderr, "bad generator '%s' (zipf:PAGES:ALPHA, loop:PAGES, scan:HOT:LENGTH, "
+                "phase:WORKING_SET:LENGTH)\n", spec);
+        return -1;
+    }
+    s->random = seed;
+    return 0;
+}
+
+
+void streamRewind(ReferenceStream *s) {
+    s->pos = 0;
+    s->produced = 0;
+    s->next_scan_page = 0;
+    s->phase_base = 0;
+    s->random = s->seed;
+}
+
+
+void streamClose(ReferenceStream *s) {
+    if (s->data != NULL)
+        munmap((void *)s->data, s->size);
+    free(s->accept);
+    free(s->alias);
+}
+
+
+static int generateReference(ReferenceStream *s) {
+    long i = s->produced++;
+    switch (s->kind) {
+        case STREAM_ZIPF: {
+            int k = randomBelow(&s->random, s->pages);
+            double u = randomUnit(&s->random);
+            return u < s->accept[k] ? k : s->alias[k];
+        }
+        case STREAM_LOOP:
+            return (int)(i % s->pages);
+        case STREAM_SCAN: {
+            //4 x HOT random references to the hot set, then SCAN pages never seen before
+            long cycle = 4L * s->pages + s->period;
+            long at = i % cycle;
+            if (at < 4L * s->pages)
+                return randomBelow(&s->random, s->pages);
+            return s->pages + s->next_scan_page++;
+        }
+        default: {
+            //uniform over a working set that moves by half its size every phase
+            if (i > 0 && i % s->period == 0)
+                s->phase_base += s->pages / 2 > 0 ? s->pages / 2 : 1;
+            return s->phase_base + randomBelow(&s->random, s->pages);
+        }
+    }
+}
+
+
+//Reads up to max references, returns how many (0 at the end of the stream)
+int streamRead(ReferenceStream *s, int *out, int max) {
+    int got = 0;
+    if (s->kind == STREAM_BINARY) {
+        size_t left = (s->size - s->pos) / sizeof(int32_t);
+        got = left < (size_t)max ? (int)left : max;
+        memcpy(out, s->data + s->pos, sizeof(int32_t) * got);
+        s->pos += sizeof(int32_t) * got;
+    } else if (s->kind == STREAM_TEXT) {
+        const unsigned char *p = s->data;
+        while (got < max && s->pos < s->size) {
+            while (s->pos < s->size && (p[s->pos] < '0' || p[s->pos] > '9'))
+                s->pos++;           //separators: spaces, commas, newlines
+            if (s->pos == s->size)
+                break;
+            int value = 0;
+            while (s->pos < s->size && p[s->pos] >= '0' && p[s->pos] <= '9')
+                value = value * 10 + (p[s->pos++] - '0');
+            out[got++] = value;
+        }
+    } else {
+        while (got < max && s->produced < s->length)
+            out[got++] = generateReference(s);
+    }
+    return got;
+}
+
+
+//Runs one policy over the stream, a chunk at a time
+long policyRunStream(const ReplacementPolicy *policy, ReferenceStream *s, int frame_count,
+                     long *references) {
+    int *chunk = (int *)malloc(sizeof(int) * STREAM_CHUNK);
+    void *state = policy->create(frame_count);
+    long pageFaults = 0;
+    int got, victim;
+    *references = 0;
+    streamRewind(s);
+    while ((got = streamRead(s, chunk, STREAM_CHUNK)) > 0) {
+        for (int k = 0; k < got; k++)
+            if (!policy->reference(state, chunk[k], &victim))
+                pageFaults++;
+        *references += got;
+    }
+    policy->destroy(state);
+    free(chunk);
+    return pageFaults;
+}
+
+
+//OPT over a stream with a lookahead of window references. The buffer holds two windows;
+//the first is simulated with next uses taken from the whole buffer, then the buffer slides.
+//A page not seen in the lookahead counts as never used again, so the result is exact when
+//every reuse distance fits in the window and an upper bound on OPT's faults otherwise.
+long optimalStreamFaults(ReferenceStream *s, int frame_count, int window) {
+    const long never = LONG_MAX / 2;
+    int capacity = 2 * window;
+    int *buffer = (int *)malloc(sizeof(int) * capacity);
+    int *next = (int *)malloc(sizeof(int) * capacity);      //next use within the buffer, or -1
+    int *frames = (int *)malloc(sizeof(int) * frame_count);
+    PageIndex index, latest;
+    pageIndexInit(&index, frame_count);
+    NextUseHeap h;
+    h.heap = (int *)malloc(sizeof(int) * frame_count);
+    h.pos = (int *)malloc(sizeof(int) * frame_count);
+    h.key = (long *)malloc(sizeof(long) * frame_count);
+    h.size = 0;
+
+    long pageFaults = 0, base = 0;      //base: stream position of buffer[0]
+    streamRewind(s);
+    int len = 0, got;
+    while (len < capacity && (got = streamRead(s, buffer + len, capacity - len)) > 0)
+        len += got;
+
+    while (len > 0) {
+        pageIndexInit(&latest, capacity);
+        for (int i = len - 1; i >= 0; i--) {
+            int pos = pageIndexFind(&latest, buffer[i]);
+            next[i] = pos;
+            if (pos != -1)
+                pageIndexRemove(&latest, buffer[i]);
+            pageIndexInsert(&latest, buffer[i], i);
+        }
+        //pages that had no use in the old lookahead may have one in the new part
+        for (int f = 0; f < h.size; f++) {
+            if (h.key[f] < never)
+                continue;
+            int pos = pageIndexFind(&latest, frames[f]);
+            if (pos != -1)
+                h.key[f] = base + pos;
+        }
+        for (int i = h.size / 2 - 1; i >= 0; i--)
+            heapSiftDown(&h, i);
+        pageIndexFree(&latest);
+
+        bool last = len < capacity;     //the stream ended inside this buffer
+        int process = last ? len : window;
+        for (int i = 0; i < process; i++) {
+            int page = buffer[i];
+            int frame = pageIndexFind(&index, page);
+            long key = next[i] != -1 ? base + next[i] : never;
+            if (frame != -1) {
+                h.key[frame] = key != never ? key : never + frame;
+                heapSiftUp(&h, h.pos[frame]);
+                continue;
+            }
+            pageFaults++;
+            if (h.size < frame_count) {
+                frame = h.size;
+                h.heap[h.size] = frame;
+                h.pos[frame] = h.size++;
+                h.key[frame] = key != never ? key : never + frame;
+                heapSiftUp(&h, h.pos[frame]);
+            } else {
+                frame = h.heap[0];
+                pageIndexRemove(&index, frames[frame]);
+                h.key[frame] = key != never ? key : never + frame;
+                heapSiftDown(&h, 0);
+            }
+            frames[frame] = page;
+            pageIndexInsert(&index, page, frame);
+        }
+
+        memmove(buffer, buffer + process, sizeof(int) * (len - process));
+        len -= process;
+        base += process;
+        while (!last && len < capacity && (got = streamRead(s, buffer + len, capacity - len)) > 0)
+            len += got;
+    }
+
+    free(h.heap);
+    free(h.pos);
+    free(h.key);
+    pageIndexFree(&index);
+    free(frames);
+    free(next);
+    free(buffer);
+    return pageFaults;
+}
+
+
+//Every policy and windowed OPT over one stream, each in its own pass
+int compareStream(ReferenceStream *s, int frame_count, int window) {
+    long n = 0;
+    printf("%d frames, OPT lookahead %d references\n", frame_count, window);
+    printf("%-10s %12s %12s %12s\n", "policy", "faults", "fault rate", "ns/ref");
+    for (int k = 0; k <= policyCount; k++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const char *name = k < policyCount ? replacementPolicies[k].name : "OPT";
+        long faults = k < policyCount
+                          ? policyRunStream(&replacementPolicies[k], s, frame_count, &n)
+                          : optimalStreamFaults(s, frame_count, window);
+        double seconds = elapsedSeconds(start);
+        printf("%-10s %12ld %11.2f%% %12.1f\n", name, faults, n ? 100.0 * faults / n : 0.0,
+               n ? seconds * 1e9 / n : 0.0);
+    }
+    printf("%ld references\n", n);
+    return 0;
+}
+
+//  Multi-process simulation: processes share one memory of frames, run round-robin and
+//  block on a single paging device while a fault is serviced
+
+static const char *allocatorNames[] = {"global LRU", "local LRU", "WS", "PFF"};
+
+enum { PROC_READY, PROC_BLOCKED, PROC_SUSPENDED, PROC_DONE };
+
+#define MULTI_QUANTUM 100         //references per scheduling turn
+#define MULTI_FAULT_TIME 200      //ticks the paging device needs per fault
+#define MULTI_PAGE_BITS 24        //page keys are pid << 24 | page
+
+typedef struct {
+    ReferenceStream refs;
+    LRUList lru;              //the process's frames, most recently used first
+    int state;
+    long vtime;               //references executed, the process's virtual time
+    long wake;                //when its page fault has been serviced
+    long last_fault;          //vtime of its previous fault (PFF)
+    int frames;               //frames held
+    int resume_need;          //frames it held when suspended
+    int fault_page;           //page of its last fault
+    bool refault;             //swapped out before that fault was used: reference it again
+    long faults;
+} SimProcess;
+
+typedef struct {
+    int policy;
+    int frame_count;
+    int tau;                  //WS window in references of the process's own virtual time
+    int pff_interval;         //PFF: a longer inter-fault time releases unused pages
+    SimProcess proc[MULTI_MAX_PROCESSES];
+    int count;
+    int *owner;               //frame -> pid, -1 when free
+    int *page;
+    long *last_use;           //frame -> owner's vtime of the last reference
+    int *free_frames;         //stack of free frames
+    int free_count;
+    int *shared_prev, *shared_next;   //links for every process list and the global one
+    LRUList global;
+    PageIndex index;          //page key -> frame
+    int ready[MULTI_MAX_PROCESSES];   //circular ready queue of pids
+    int ready_head, ready_count;
+    long now, device_free;
+    long suspensions;
+} MultiSim;
+
+
+static int pageKey(int pid, int page) {
+    return (pid << MULTI_PAGE_BITS) | (page & ((1 << MULTI_PAGE_BITS) - 1));
+}
+
+
+static void readyPush(MultiSim *sim, int pid) {
+    sim->ready[(sim->ready_head + sim->ready_count++) % MULTI_MAX_PROCESSES] = pid;
+    sim->proc[pid].state = PROC_READY;
+}
+
+
+static int readyPop(MultiSim *sim) {
+    int pid = sim->ready[sim->ready_head];
+    sim->ready_head = (sim->ready_head + 1) % MULTI_MAX_PROCESSES;
+    sim->ready_count--;
+    return pid;
+}
+
+
+static void releaseFrame(MultiSim *sim, int frame) {
+    SimProcess *p = &sim->proc[sim->owner[frame]];
+    lruListUnlink(sim->policy == ALLOC_GLOBAL_LRU ? &sim->global : &p->lru, frame);
+    pageIndexRemove(&sim->index, pageKey(sim->owner[frame], sim->page[frame]));
+    p->frames--;
+    sim->owner[frame] = -1;
+    sim->free_frames[sim->free_count++] = frame;
+}
+
+
+static void releaseAll(MultiSim *sim, int pid) {
+    LRUList *list = sim->policy == ALLOC_GLOBAL_LRU ? NULL : &sim->proc[pid].lru;
+    if (list != NULL) {
+        while (list->tail != -1)
+            releaseFrame(sim, list->tail);
+        return;
+    }
+    for (int f = 0; f < sim->frame_count; f++)
+        if (sim->owner[f] == pid)
+            releaseFrame(sim, f);
+}
+
+
+//Load control for WS and PFF: suspended processes come back, oldest first, once memory
+//holds what they had; with nothing left to run the first one returns regardless
+static void resumeProcesses(MultiSim *sim) {
+    for (int pid = 0; pid < sim->count; pid++) {
+        SimProcess *p = &sim->proc[pid];
+        if (p->state != PROC_SUSPENDED)
+            continue;
+        bool idle = true;
+        for (int q = 0; q < sim->count; q++)
+            if (sim->proc[q].state == PROC_READY || sim->proc[q].state == PROC_BLOCKED)
+                idle = false;
+        if (sim->free_count >= p->resume_need || idle)
+            readyPush(sim, pid);
+    }
+}
+
+
+//Memory is overcommitted: swap out the newest running process other than pid, ready or
+//waiting for the device. A waiting process loses the page it faulted on along with the
+//rest, so it makes that reference again after it resumes.
+static bool suspendOne(MultiSim *sim, int pid) {
+    for (int victim = sim->count - 1; victim >= 0; victim--) {
+        SimProcess *v = &sim->proc[victim];
+        if (victim == pid || v->frames == 0 ||
+            (v->state != PROC_READY && v->state != PROC_BLOCKED))
+            continue;
+        if (v->state == PROC_READY) {
+            int k = 0;
+            while (sim->ready[(sim->ready_head + k) % MULTI_MAX_PROCESSES] != victim)
+                k++;
+            for (; k < sim->ready_count - 1; k++)
+                sim->ready[(sim->ready_head + k) % MULTI_MAX_PROCESSES] =
+                    sim->ready[(sim->ready_head + k + 1) % MULTI_MAX_PROCESSES];
+            sim->ready_count--;
+        }
+        v->resume_need = v->frames;
+        v->refault = v->state == PROC_BLOCKED;
+        releaseAll(sim, victim);
+        v->state = PROC_SUSPENDED;
+        sim->suspensions++;
+        return true;
+    }
+    return false;
+}
+
+
+static int takeFrame(MultiSim *sim, int pid) {
+    SimProcess *p = &sim->proc[pid];
+    int quota = sim->frame_count / sim->count;
+
+    if (sim->policy == ALLOC_GLOBAL_LRU) {
+        if (sim->free_count == 0)
+            releaseFrame(sim, sim->global.tail);
+    } else if (sim->policy == ALLOC_LOCAL_LRU) {
+        if (p->frames >= quota || sim->free_count == 0)
+            releaseFrame(sim, p->lru.tail);
+    } else if (sim->free_count == 0 && !suspendOne(sim, pid)) {
+        //nobody to swap out: replace locally, or take the LRU page of the largest process
+        int from = pid;
+        if (p->frames == 0)
+            for (int q = 0; q < sim->count; q++)
+                if (sim->proc[q].frames > sim->proc[from].frames)
+                    from = q;
+        releaseFrame(sim, sim->proc[from].lru.tail);
+    }
+    return sim->free_frames[--sim->free_count];
+}
+
+
+//One reference of process pid; returns false on a page fault
+static bool multiReference(MultiSim *sim, int pid, int page_num) {
+    SimProcess *p = &sim->proc[pid];
+    LRUList *list = sim->policy == ALLOC_GLOBAL_LRU ? &sim->global : &p->lru;
+    int key = pageKey(pid, page_num);
+    p->vtime++;
+
+    int frame = pageIndexFind(&sim->index, key);
+    bool hit = frame != -1;
+    if (hit) {
+        lruListUnlink(list, frame);
+    } else {
+        if (sim->policy == ALLOC_PFF && p->vtime - p->last_fault > sim->pff_interval) {
+            //faults are rare: give back every page not used since the previous fault
+            while (p->lru.tail != -1 && sim->last_use[p->lru.tail] < p->last_fault)
+                releaseFrame(sim, p->lru.tail);
+        }
+        p->last_fault = p->vtime;
+        frame = takeFrame(sim, pid);
+        sim->owner[frame] = pid;
+        sim->page[frame] = page_num;
+        pageIndexInsert(&sim->index, key, frame);
+        p->frames++;
+    }
+    sim->last_use[frame] = p->vtime;
+    lruListPushFront(list, frame);
+
+    if (sim->policy == ALLOC_WORKING_SET) {
+        //the resident set is exactly the pages referenced in the last tau references
+        while (sim->last_use[p->lru.tail] <= p->vtime - sim->tau)
+            releaseFrame(sim, p->lru.tail);
+    }
+    return hit;
+}
+
+
+//count processes, each running references from "phase:SET:LENGTH" with its own seed
+//(1000 + pid), so the processes draw different pages
+MultiResult runMultiprogram(int policy, int count, int frame_count, long references,
+                            int working_set, int tau, int pff_interval) {
+    MultiSim *sim = (MultiSim *)calloc(1, sizeof(MultiSim));
+    sim->policy = policy;
+    sim->frame_count = frame_count;
+    sim->tau = tau;
+    sim->pff_interval = pff_interval;
+    sim->count = count;
+    sim->owner = (int *)malloc(sizeof(int) * frame_count);
+    sim->page = (int *)malloc(sizeof(int) * frame_count);
+    sim->last_use = (long *)malloc(sizeof(long) * frame_count);
+    sim->free_frames = (int *)malloc(sizeof(int) * frame_count);
+    sim->shared_prev = (int *)malloc(sizeof(int) * frame_count);
+    sim->shared_next = (int *)malloc(sizeof(int) * frame_count);
+    for (int f = frame_count - 1; f >= 0; f--) {
+        sim->owner[f] = -1;
+        sim->free_frames[sim->free_count++] = f;
+    }
+    sim->global = (LRUList){sim->shared_prev, sim->shared_next, -1, -1};
+    pageIndexInit(&sim->index, frame_count);
+
+    char spec[64];
+    snprintf(spec, sizeof(spec), "phase:%d:%d", working_set, 100 * working_set);
+    for (int pid = 0; pid < count; pid++) {
+        SimProcess *p = &sim->proc[pid];
+        streamOpenGenerator(&p->refs, spec, references, 1000 + pid);
+        p->lru = (LRUList){sim->shared_prev, sim->shared_next, -1, -1};
+        readyPush(sim, pid);
+    }
+
+    MultiResult result = {0, 0, 0, 0};
+    int done = 0;
+    while (done < count) {
+        //processes whose fault was serviced rejoin the queue in completion order
+        for (;;) {
+            int next = -1;
+            for (int pid = 0; pid < count; pid++)
+                if (sim->proc[pid].state == PROC_BLOCKED && sim->proc[pid].wake <= sim->now &&
+                    (next == -1 || sim->proc[pid].wake < sim->proc[next].wake))
+                    next = pid;
+            if (next == -1)
+                break;
+            readyPush(sim, next);
+        }
+        if (sim->ready_count == 0) {
+            long wake = -1;
+            for (int pid = 0; pid < count; pid++)
+                if (sim->proc[pid].state == PROC_BLOCKED && (wake == -1 || sim->proc[pid].wake < wake))
+                    wake = sim->proc[pid].wake;
+            if (wake == -1)
+                resumeProcesses(sim);      //only suspended processes are left
+            else
+                sim->now = wake;           //the CPU idles until the device finishes
+            continue;
+        }
+
+        int pid = readyPop(sim);
+        SimProcess *p = &sim->proc[pid];
+        for (int q = 0; q < MULTI_QUANTUM; q++) {
+            int page_num;
+            bool again = p->refault;
+            if (again) {
+                page_num = p->fault_page;
+                p->refault = false;
+            } else if (streamRead(&p->refs, &page_num, 1) == 0) {
+                p->state = PROC_DONE;
+                done++;
+                releaseAll(sim, pid);
+                resumeProcesses(sim);
+                break;
+            }
+            sim->now++;
+            if (!again)
+                result.references++;
+            if (!multiReference(sim, pid, page_num)) {
+                p->fault_page = page_num;
+                p->faults++;
+                result.faults++;
+                sim->device_free = (sim->device_free > sim->now ? sim->device_free : sim->now) +
+                                   MULTI_FAULT_TIME;
+                p->wake = sim->device_free;
+                p->state = PROC_BLOCKED;
+                break;
+            }
+        }
+        if (p->state == PROC_READY)
+            readyPush(sim, pid);
+        if (sim->policy == ALLOC_WORKING_SET || sim->policy == ALLOC_PFF)
+            resumeProcesses(sim);
+    }
+
+    result.ticks = sim->now;
+    result.suspensions = sim->suspensions;
+    for (int pid = 0; pid < count; pid++)
+        streamClose(&sim->proc[pid].refs);
+    pageIndexFree(&sim->index);
+    free(sim->owner);
+    free(sim->page);
+    free(sim->last_use);
+    free(sim->free_frames);
+    free(sim->shared_prev);
+    free(sim->shared_next);
+    free(sim);
+    return result;
+}
+
+
+//Faults and CPU utilisation (references / ticks) for 1 .. max_processes under every
+//allocator. Thrashing sets in where adding a process drops utilisation below 80% of the
+//best seen with fewer processes.
+int multiprogramming(int max_processes, int frame_count, long references, int working_set) {
+    int tau = 8 * working_set;
+    int pff_interval = 2 * working_set;
+    double best[ALLOC_COUNT] = {0};
+    int onset[ALLOC_COUNT] = {0};
+
+    printf("%d frames, %ld references per process, working sets of %d pages, "
+           "fault service %d ticks, WS tau %d, PFF interval %d\n",
+           frame_count, references, working_set, MULTI_FAULT_TIME, tau, pff_interval);
+    printf("%5s", "procs");
+    for (int a = 0; a < ALLOC_COUNT; a++)
+        printf(" | %-10s %9s %6s", allocatorNames[a], "faults", "util");
+    printf("\n");
+
+    for (int count = 1; count <= max_processes; count++) {
+        printf("%5d", count);
+        for (int a = 0; a < ALLOC_COUNT; a++) {
+            MultiResult r = runMultiprogram(a, count, frame_count, references, working_set, tau,
+                                            pff_interval);
+            double util = r.ticks ? (double)r.references / r.ticks : 0.0;
+            bool thrashing = util < 0.8 * best[a];
+            if (thrashing && onset[a] == 0)
+                onset[a] = count;
+            if (util > best[a])
+                best[a] = util;
+            char note[32] = "";
+            if (r.suspensions > 0)
+                snprintf(note, sizeof(note), "%ld sw", r.suspensions);
+            printf(" | %-10s %9ld %5.1f%%", note, r.faults, 100.0 * util);
+            printf("%s", thrashing ? "!" : " ");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    printf("\nthrashing onset (utilisation < 80%% of best):");
+    for (int a = 0; a < ALLOC_COUNT; a++) {
+        if (onset[a]) printf("  %s at %d processes", allocatorNames[a], onset[a]);
+        else printf("  %s none", allocatorNames[a]);
+    }
+    printf("\n");
+    return 0;
+}
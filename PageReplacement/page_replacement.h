@@ -0,0 +1,120 @@
+#ifndef PAGE_REPLACEMENT_H
+#define PAGE_REPLACEMENT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//Page replacement simulators. Every run owns its state, so a program can drive any number
+//of them; the report functions print to stdout.
+
+enum { LOG_QUIET, LOG_SUMMARY, LOG_FAULTS, LOG_STEPS };    //verbosity levels
+
+enum { ALGORITHM_FIFO, ALGORITHM_LRU, ALGORITHM_OPT };
+
+
+typedef struct {    //one record of the binary event log, 12 bytes
+    uint32_t index;           //reference position, PAGE_EVENT_HIT is set on a hit
+    int32_t page;
+    int32_t victim;           //page evicted by this fault, -1 if none
+} PageEvent;
+
+#define PAGE_EVENT_HIT 0x80000000u
+#define PAGE_EVENT_RUN 0xFFFFFFFFu   //opens a run: page is the frame count, victim the algorithm
+#define EVENT_BUFFER 4096
+
+
+typedef struct {    //where a simulation reports: text up to a verbosity level, events in binary
+    int verbosity;
+    FILE *events;             //NULL: no event log
+    PageEvent buffer[EVENT_BUFFER];
+    int buffered;
+    int algorithm;
+} SimulationLog;
+
+
+//The logging simulators, kept for teaching: they print every step up to log->verbosity
+void fifoPageReplacement(int pages[], int n, int frame_count, SimulationLog *log);
+void lruPageReplacement(int pages[], int n, int frame_count, SimulationLog *log);
+void optimalPageReplacement(int pages[], int n, int frame_count, SimulationLog *log);
+int optimalRun(int pages[], int n, int frame_count, SimulationLog *log);   //returns faults
+int decodeEvents(const char *path, bool summary_only);
+int benchmarkOptimal(long max_n, int frame_count);
+
+
+//Replacement policies behind one interface. reference() returns true on a hit; on a fault
+//that had to evict, *victim is the page that left memory, otherwise -1.
+typedef struct {
+    const char *name;
+    void *(*create)(int frame_count);
+    bool (*reference)(void *policy, int page, int *victim);
+    void (*destroy)(void *policy);
+} ReplacementPolicy;
+
+extern const ReplacementPolicy replacementPolicies[];   //FIFO, LRU, CLOCK, 2Q, ARC, LIRS, CLOCK-Pro
+extern const int policyCount;
+
+const ReplacementPolicy *findPolicy(const char *name);  //NULL if there is no such policy
+int policyRun(const ReplacementPolicy *policy, int pages[], int n, int frame_count);
+void mixedTrace(int pages[], int n, int frame_count);
+int comparePolicies(int n, int frame_count);
+
+
+//Fault curves: index c holds the faults with c frames, for c = 1 .. max_frames. The caller
+//frees the LRU and OPT curves and munmaps the count * (max_frames + 1) ints policyFaultCurves
+//returns (NULL on failure), policy k's curve starting at k * (max_frames + 1).
+int *lruFaultCurve(int pages[], int n, int max_frames);
+int *optFaultCurve(int pages[], int n, int max_frames);
+int *policyFaultCurves(const ReplacementPolicy *policies[], int count, int pages[], int n,
+                       int max_frames, int jobs);
+int faultCurves(int pages[], int n, int max_frames, int jobs, const char *names);
+
+
+enum { STREAM_BINARY, STREAM_TEXT, STREAM_ZIPF, STREAM_LOOP, STREAM_SCAN, STREAM_PHASE };
+
+#define STREAM_CHUNK 65536
+
+typedef struct {
+    int kind;
+    const unsigned char *data;    //mapped file
+    size_t size;
+    size_t pos;
+    long length;                  //generators: references to produce
+    long produced;
+    int pages;                    //zipf and loop: distinct pages; scan and phase: hot set size
+    int period;                   //scan: scan length; phase: references per phase
+    double alpha;
+    double *accept;               //zipf alias table: keep page k with probability accept[k],
+    int *alias;                   //otherwise take alias[k]
+    int next_scan_page;
+    int phase_base;
+    unsigned int seed;
+    uint64_t random;              //generator state, reset to seed on rewind
+} ReferenceStream;
+
+int streamOpenFile(ReferenceStream *s, const char *path);
+//spec: zipf:PAGES:ALPHA, loop:PAGES, scan:HOT:LENGTH or phase:SET:LENGTH
+int streamOpenGenerator(ReferenceStream *s, const char *spec, long length, unsigned int seed);
+void streamRewind(ReferenceStream *s);
+void streamClose(ReferenceStream *s);
+int streamRead(ReferenceStream *s, int *out, int max);
+long policyRunStream(const ReplacementPolicy *policy, ReferenceStream *s, int frame_count,
+                     long *references);
+long optimalStreamFaults(ReferenceStream *s, int frame_count, int window);
+int compareStream(ReferenceStream *s, int frame_count, int window);
+
+
+enum { ALLOC_GLOBAL_LRU, ALLOC_LOCAL_LRU, ALLOC_WORKING_SET, ALLOC_PFF, ALLOC_COUNT };
+
+#define MULTI_MAX_PROCESSES 64
+
+typedef struct {
+    long references, faults, ticks, suspensions;
+} MultiResult;
+
+MultiResult runMultiprogram(int policy, int count, int frame_count, long references,
+                            int working_set, int tau, int pff_interval);
+int multiprogramming(int max_processes, int frame_count, long references, int working_set);
+
+#endif
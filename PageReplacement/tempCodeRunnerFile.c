@@ -1,5 +0,0 @@
-    // printf("\nLRU Algorithm:\n");
-    // lruPageReplacement(pages, n, frame_count);
-
-    // printf("\nOptimal Algorithm:\n");
-    // optimalPageReplacement(pages, n, frame_count);
\ No newline at end of file
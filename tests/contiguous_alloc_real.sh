@@ -0,0 +1,23 @@
+#!/bin/sh
+# Real-backed trace replay tight enough to compact: every strategy must move
+# blocks and still read back each block's fill pattern when it is freed
+# usage: contiguous_alloc_real.sh path/to/contiguous_alloc
+set -e
+alloc="$1"
+trace=$(mktemp)
+out=$(mktemp)
+trap 'rm -f "$trace" "$out"' EXIT
+
+# 50 live blocks of 1..4096 bytes in 128 KiB
+awk 'BEGIN {
+    for (i = 0; i < 4000; i++) {
+        print "a", i, 1 + (i * 2654435761) % 4096
+        if (i >= 50) print "f", i - 50
+    }
+}' > "$trace"
+
+"$alloc" real "$trace" 131072 0 > "$out"
+cat "$out"
+[ "$(wc -l < "$out")" -eq 3 ]
+[ "$(grep -c '| corrupt 0 |' "$out")" -eq 3 ]
+if grep -q '| compactions 0 ' "$out"; then exit 1; fi
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Files are reported after the files they depend on ("...base.txt" on the
+# first line), plain or compressed
+# usage: log_analyzer_order.sh path/to/log_analyzer logs_dir expected_file...
+set -e
+analyzer="$1"
+dir="$2"
+shift 2
+out=$(mktemp)
+trap 'rm -f "$out"' EXIT
+
+"$analyzer" -d "$dir" -o "$out"
+order=$(sed -n 's/^\([^ ]*\): [0-9]* bugs$/\1/p' "$out" | tr '\n' ' ')
+echo "order: $order"
+[ "$order" = "$* " ]
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Matching lines and per-file counts of the plain fixture logs against the
+# checked-in output, and the line counts of the aggregated summary
+# usage: log_analyzer_output.sh path/to/log_analyzer Log_Analyzer_dir
+set -e
+analyzer="$1"
+dir="$2"
+out=$(mktemp)
+trap 'rm -f "$out"' EXIT
+
+"$analyzer" -d "$dir/logs" -o "$out"
+diff "$dir/output.txt" "$out"
+
+"$analyzer" -d "$dir/logs" -o "$out" -a
+grep -qx 'Lines: ERROR=4 INFO=2 WARNING=1' "$out"
+grep -qx '2024-05-01 12:01  ERROR=1 INFO=0 WARNING=0  error rate 100.00%' "$out"
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Sampled simulation of a 4-core trace replayed with fewer cores: the
+# estimate must land within the 5% target (or its own interval) of the
+# full replay of the same records
+# usage: memory_hierarchy_sampled_cores.sh path/to/memory_hierarchy
+set -e
+sim="$1"
+trace=$(mktemp)
+trap 'rm -f "$trace"' EXIT
+
+# core 0 faults over 3000 pages, cores 1..3 loop over 40 addresses each
+awk 'BEGIN {
+    for (i = 0; i < 400000; i++) {
+        c = i % 4
+        h = (i * 2654435761) % 4294967296
+        if (c == 0) a = h % 3000
+        else a = 4000 * c + h % 40
+        print c, (h % 10 < 3 ? "W" : "R"), a
+    }
+}' > "$trace"
+
+for cores in 1 2 4; do
+    full=$("$sim" -t "$trace" -c $cores 2>/dev/null | awk '/^Average Access Time/ { print $4 }')
+    sampled=$("$sim" -t "$trace" -c $cores -e 0.05 | awk '/^Average Access Time/ { print $4, $6 }')
+    echo "-c $cores: full $full, sampled $sampled"
+    echo "$full $sampled" | awk '{
+        diff = $1 > $2 ? $1 - $2 : $2 - $1
+        if ($3 <= 0 || (diff > 3 * $3 && diff > 0.05 * $1)) exit 1
+    }'
+done
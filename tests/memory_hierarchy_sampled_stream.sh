@@ -0,0 +1,22 @@
+#!/bin/sh
+# With stream buffers, the sampled L2 hit ratio must use the full report's
+# definition (stream buffer hits are neither L2 hits nor misses)
+# usage: memory_hierarchy_sampled_stream.sh path/to/memory_hierarchy
+set -e
+sim="$1"
+trace=$(mktemp)
+trap 'rm -f "$trace"' EXIT
+
+# a sequential stream interleaved with a 200-line hot set
+awk 'BEGIN {
+    for (i = 0; i < 400000; i++) {
+        if (i % 2) print "R", (i * 2) % 200000 + 100000
+        else print "R", ((i * 2654435761) % 4294967296) % 200 * 4
+    }
+}' > "$trace"
+
+args="-t $trace -P stream -l 4 -g page=64,vm=65536"
+full=$("$sim" $args | awk '/^L2 Hit Ratio/ { sub("%", "", $4); print $4 }')
+sampled=$("$sim" $args -e 0.05 | awk '/^L2 Hit Ratio/ { sub("%", "", $4); print $4 }')
+echo "L2 hit ratio: full $full%, sampled $sampled%"
+echo "$full $sampled" | awk '{ d = $1 - $2; if (d < -1 || d > 1) exit 1 }'
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Belady's anomaly on the classic 1 2 3 4 1 2 5 1 2 3 4 5 string: FIFO takes
+# 9 faults with 3 frames but 10 with 4, and only that row is flagged
+# usage: page_replacement_belady.sh path/to/page_replacement
+set -e
+sim="$1"
+curve=$("$sim" curve belady 5 2 FIFO 2>/dev/null)
+echo "$curve"
+[ "$(echo "$curve" | sed -n 1p)" = "frames,LRU,OPT,FIFO,FIFO_anomaly" ]
+[ "$(echo "$curve" | sed -n 4p)" = "3,10,7,9,0" ]
+[ "$(echo "$curve" | sed -n 5p)" = "4,8,6,10,1" ]
+[ "$(echo "$curve" | awk -F, 'NR > 1 { n += $5 } END { print n }')" = 1 ]